@@ -0,0 +1,376 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "asset.h"
+#include "config.h"
+#include "draw.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <unistd.h>
+}
+
+// --------------------------------------------------------------------------
+//
+// Manifest
+//
+// Everything the game reads from the data directory. Textures carry the
+// filter and wrap mode they are uploaded with; sprites share the atlas
+// and are always filtered linearly.
+//
+// --------------------------------------------------------------------------
+
+struct AssetEntry {
+    const char* name;
+    AssetManager::Type type;
+    int filter, wrap;
+};
+
+static const AssetEntry MANIFEST[] = {
+    { "ast.png", AssetManager::TEXTURE, GL_NEAREST, GL_CLAMP },
+
+    { "enemyAmmo00.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmo01.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmo02.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmo03.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmo04.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmoExplo00.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmoExplo01.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmoExplo02.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmoExplo03.png", AssetManager::SPRITE, 0, 0 },
+    { "enemyAmmoExplo04.png", AssetManager::SPRITE, 0, 0 },
+    { "heroAmmoFlash00.png", AssetManager::SPRITE, 0, 0 },
+    { "heroAmmoFlash01.png", AssetManager::SPRITE, 0, 0 },
+    { "heroAmmoFlash02.png", AssetManager::SPRITE, 0, 0 },
+
+    { "boom.wav", AssetManager::SOUND, 0, 0 },
+    { "exploBig.wav", AssetManager::SOUND, 0, 0 },
+    { "exploPop.wav", AssetManager::SOUND, 0, 0 },
+    { "life_lose.wav", AssetManager::SOUND, 0, 0 },
+    { "power.wav", AssetManager::SOUND, 0, 0 },
+    { "trance.wav", AssetManager::MUSIC, 0, 0 },
+
+    { "Vera.ttf", AssetManager::FONT, 0, 0 },
+};
+
+static const std::size_t MANIFEST_SIZE = sizeof(MANIFEST) / sizeof(MANIFEST[0]);
+
+// Width of the sprite atlas; the height grows to fit.
+static const unsigned int ATLAS_WIDTH = 256;
+
+// A directory is accepted as the data directory if it holds this file.
+static const char* SENTINEL = "ast.png";
+
+// --------------------------------------------------------------------------
+
+AssetManager::AssetManager()
+    : mAtlasTexture(0)
+{
+    mAssets.resize(MANIFEST_SIZE);
+    for (std::size_t i = 0; i < MANIFEST_SIZE; i++) {
+        Asset& a = mAssets[i];
+        a.name = MANIFEST[i].name;
+        a.type = MANIFEST[i].type;
+        a.filter = MANIFEST[i].filter;
+        a.wrap = MANIFEST[i].wrap;
+        a.loaded = false;
+        a.failed = false;
+        a.image.Data = 0;
+        a.texture = 0;
+    }
+}
+
+AssetManager::~AssetManager()
+{
+    if (mLoader.joinable()) {
+        mLoader.join();
+    }
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        free(mAssets[i].image.Data);
+    }
+}
+
+static bool hasSentinel(const std::string& dir)
+{
+    std::string path = dir + "/" + SENTINEL;
+    return access(path.c_str(), R_OK) == 0;
+}
+
+void AssetManager::resolveDataDir()
+{
+    std::vector<std::string> search;
+
+    const char* configured = Config::getInstance().getDataDir();
+    if (configured[0]) {
+        search.push_back(configured);
+    }
+
+    const char* home = getenv("HOME");
+    if (home) {
+        search.push_back(std::string(home) + "/.ssc");
+    }
+    search.push_back("/usr/local/share/ssc");
+    search.push_back("/usr/share/ssc");
+    search.push_back("data");
+    search.push_back("../data");
+
+    for (std::size_t i = 0; i < search.size(); i++) {
+        if (hasSentinel(search[i])) {
+            mDataDir = search[i];
+            return;
+        }
+    }
+
+    fprintf(stderr, "Could not find the data directory (looked for %s)\n",
+            SENTINEL);
+    exit(1);
+}
+
+void AssetManager::startLoading()
+{
+    if (mLoader.joinable() || !mDataDir.empty()) {
+        return;
+    }
+
+    resolveDataDir();
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        mAssets[i].path = mDataDir + "/" + mAssets[i].name;
+    }
+
+    mLoader = std::thread(&AssetManager::load, this);
+}
+
+// Loader thread. Each asset is only touched by this thread until its
+// loaded flag is published under the mutex.
+
+void AssetManager::load()
+{
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        Asset& a = mAssets[i];
+        bool ok = false;
+
+        if (a.type == TEXTURE || a.type == SPRITE) {
+            ok = pngLoadRaw(a.path.c_str(), &a.image) != 0;
+        } else if (a.type == SOUND || a.type == MUSIC) {
+            ok = access(a.path.c_str(), R_OK) == 0;
+        } else {
+            FILE* fp = fopen(a.path.c_str(), "rb");
+            if (fp) {
+                fseek(fp, 0, SEEK_END);
+                long size = ftell(fp);
+                fseek(fp, 0, SEEK_SET);
+                if (size > 0) {
+                    a.data.resize(size);
+                    ok = fread(&a.data[0], 1, size, fp) == (std::size_t)size;
+                }
+                fclose(fp);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        a.failed = !ok;
+        a.loaded = true;
+        mLoaded.notify_all();
+    }
+}
+
+void AssetManager::wait(Handle h)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mLoaded.wait(lock, [this, h] { return mAssets[h].loaded; });
+}
+
+AssetManager::Handle AssetManager::find(const char* name)
+{
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        if (!strcmp(mAssets[i].name, name)) {
+            return (Handle)i;
+        }
+    }
+    return INVALID;
+}
+
+static GLenum pixelFormat(const pngRawInfo& image)
+{
+    switch (image.Components) {
+    case 1:
+        return GL_LUMINANCE;
+    case 2:
+        return GL_LUMINANCE_ALPHA;
+    case 3:
+        return GL_RGB;
+    default:
+        return GL_RGBA;
+    }
+}
+
+void AssetManager::uploadTexture(Asset& a)
+{
+    GLenum format = pixelFormat(a.image);
+
+    glGenTextures(1, &a.texture);
+    glBindTexture(GL_TEXTURE_2D, a.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, a.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, a.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, a.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, a.wrap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format,
+                 a.image.Width, a.image.Height, 0,
+                 format, GL_UNSIGNED_BYTE, a.image.Data);
+}
+
+// Shelf-pack the sprite images, tallest first, into one RGBA texture.
+// Every image keeps a one texel transparent border so linear filtering at
+// the cell edge fades to nothing, as GL_CLAMP did with separate textures.
+
+void AssetManager::buildAtlas()
+{
+    std::vector<Asset*> sprites;
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        if (mAssets[i].type == SPRITE) {
+            sprites.push_back(&mAssets[i]);
+        }
+    }
+    if (sprites.empty()) {
+        return;
+    }
+
+    std::stable_sort(sprites.begin(), sprites.end(),
+                     [](const Asset* a, const Asset* b) {
+                         return a->image.Height > b->image.Height;
+                     });
+
+    // place the cells
+    std::vector<unsigned int> px(sprites.size()), py(sprites.size());
+    unsigned int x = 0, y = 0, shelf = 0;
+    for (std::size_t i = 0; i < sprites.size(); i++) {
+        unsigned int w = sprites[i]->image.Width + 2,
+                     h = sprites[i]->image.Height + 2;
+        assert(w <= ATLAS_WIDTH);
+        if (x + w > ATLAS_WIDTH) {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+        px[i] = x + 1;
+        py[i] = y + 1;
+        x += w;
+        shelf = std::max(shelf, h);
+    }
+
+    unsigned int height = 1;
+    while (height < y + shelf) {
+        height <<= 1;
+    }
+
+    // copy the pixels, expanding everything to RGBA
+    std::vector<unsigned char> pixels(ATLAS_WIDTH * height * 4, 0);
+    for (std::size_t i = 0; i < sprites.size(); i++) {
+        Asset& a = *sprites[i];
+        const unsigned int n = a.image.Components;
+
+        for (unsigned int row = 0; row < a.image.Height; row++) {
+            const unsigned char* src = a.image.Data + row * a.image.Width * n;
+            unsigned char* dst = &pixels[((py[i] + row) * ATLAS_WIDTH + px[i]) * 4];
+
+            for (unsigned int col = 0; col < a.image.Width; col++, src += n, dst += 4) {
+                if (n < 3) {
+                    dst[0] = dst[1] = dst[2] = src[0];
+                } else {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                }
+                dst[3] = (n == 2 || n == 4) ? src[n - 1] : 255;
+            }
+        }
+
+        a.cell.u0 = (float)px[i] / ATLAS_WIDTH;
+        a.cell.v0 = (float)py[i] / height;
+        a.cell.u1 = (float)(px[i] + a.image.Width) / ATLAS_WIDTH;
+        a.cell.v1 = (float)(py[i] + a.image.Height) / height;
+    }
+
+    glGenTextures(1, &mAtlasTexture);
+    glBindTexture(GL_TEXTURE_2D, mAtlasTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_WIDTH, height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+}
+
+void AssetManager::upload()
+{
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        Asset& a = mAssets[i];
+        if (a.type != TEXTURE && a.type != SPRITE) {
+            continue;
+        }
+
+        wait((Handle)i);
+        if (a.failed) {
+            fprintf(stderr, "can't load %s\n", a.path.c_str());
+            abort();
+        }
+        if (a.type == TEXTURE && !a.texture) {
+            uploadTexture(a);
+        }
+    }
+
+    if (!mAtlasTexture) {
+        buildAtlas();
+    }
+
+    for (std::size_t i = 0; i < mAssets.size(); i++) {
+        free(mAssets[i].image.Data);
+        mAssets[i].image.Data = 0;
+    }
+
+    if (mLoader.joinable()) {
+        mLoader.join();
+    }
+}
+
+unsigned int AssetManager::texture(Handle h)
+{
+    assert(h != INVALID);
+    return mAssets[h].texture;
+}
+
+const SpriteCell& AssetManager::sprite(Handle h)
+{
+    assert(h != INVALID && mAssets[h].type == SPRITE);
+    return mAssets[h].cell;
+}
+
+const unsigned char* AssetManager::bytes(Handle h, std::size_t* size)
+{
+    if (h == INVALID) {
+        *size = 0;
+        return 0;
+    }
+
+    wait(h);
+
+    Asset& a = mAssets[h];
+    if (a.failed) {
+        *size = 0;
+        return 0;
+    }
+    *size = a.data.size();
+    return &a.data[0];
+}
@@ -0,0 +1,130 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_ASSET_H
+#define SSC_ASSET_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glpng.h"
+
+// Texture coordinates of one image inside the sprite atlas.
+struct SpriteCell {
+    float u0, v0, u1, v1;
+
+    SpriteCell flipV() const
+    {
+        SpriteCell c = { u0, v1, u1, v0 };
+        return c;
+    }
+};
+
+// --------------------------------------------------------------------------
+//
+// CLASS: AssetManager
+//
+// Owns every texture, sound and font file the game reads from the data
+// directory. startLoading() resolves the directory, then reads and decodes
+// the whole manifest on a background thread while the window and audio
+// device are being set up. upload() runs on the GL thread before the first
+// frame and turns the decoded images into texture objects, so no draw call
+// ever touches the disk or the PNG decoder.
+//
+// Small additive sprites (ammo, explosion and flash images) are packed
+// into a single atlas texture at upload time so they can all be drawn with
+// one bind; see SpriteBatch.
+//
+// Sounds and music are not read here, only checked for: the sound bank
+// decodes or maps the effects itself and the music is streamed from its
+// file while it plays.
+//
+// Assets are addressed by handle; look the handle up once with find() and
+// keep it.
+//
+// --------------------------------------------------------------------------
+
+class AssetManager {
+public:
+    typedef int Handle;
+    static const Handle INVALID = -1;
+
+    enum Type { TEXTURE,
+                SPRITE,
+                SOUND,
+                MUSIC,
+                FONT };
+
+    static AssetManager& getInstance()
+    {
+        static AssetManager instance;
+        return instance;
+    }
+
+    ~AssetManager();
+
+    void startLoading();
+    void upload();
+
+    const char* dataDir() { return mDataDir.c_str(); }
+
+    Handle find(const char* name);
+
+    // GL texture name; valid after upload()
+    unsigned int texture(Handle h);
+
+    // atlas cell of a SPRITE asset, and the atlas texture; valid after upload()
+    const SpriteCell& sprite(Handle h);
+    unsigned int spriteAtlas() { return mAtlasTexture; }
+
+    // Raw file contents of a font, blocking until the loader has read it.
+    // Returns NULL if the file could not be read.
+    const unsigned char* bytes(Handle h, std::size_t* size);
+
+    // full path of the file in the data directory; valid after startLoading()
+    const char* path(Handle h) { return mAssets[h].path.c_str(); }
+
+private:
+    struct Asset {
+        const char* name;
+        Type type;
+        int filter, wrap;
+
+        std::string path;
+        bool loaded, failed;
+
+        pngRawInfo image;
+        std::vector<unsigned char> data;
+        unsigned int texture;
+        SpriteCell cell;
+    };
+
+    AssetManager();
+
+    void resolveDataDir();
+    void load();
+    void wait(Handle h);
+    void uploadTexture(Asset& a);
+    void buildAtlas();
+
+    std::string mDataDir;
+    std::vector<Asset> mAssets;
+    unsigned int mAtlasTexture;
+
+    std::mutex mMutex;
+    std::condition_variable mLoaded;
+    std::thread mLoader;
+};
+
+#endif // SSC_ASSET_H
@@ -1,5 +1,8 @@
 #include "asteroid.h"
+#include "asset.h"
 #include "draw.h"
+#include "quality.h"
+#include "snapshot.h"
 
 const double ASTEROID_MASS = 1000;
 
@@ -10,7 +13,8 @@ Asteroid::Asteroid(double sz)
                    100, // maxspeed
                    rand() % Screen::maxX(), rand() % Screen::maxY(), 0,
                    0, 0, 0)
-    , mFirstDraw(true)
+    , mMesh(Snapshot::shareMesh(new IndexedMesh()))
+    , mCoarseMesh(Snapshot::shareMesh(new IndexedMesh()))
 {
     setup(sz, -1, -1);
     rot.set(drand48() * D_PI, drand48() * D_PI, drand48() * D_PI);
@@ -19,31 +23,21 @@ Asteroid::Asteroid(double sz)
     setState(ALIVE);
 }
 
-inline void pushTriangle(std::vector<Triangle>& tri,
-                         double x1, double y1, double z1,
-                         double x2, double y2, double z2,
-                         double x3, double y3, double z3)
-{
-    Triangle tt;
-    tt.v1.vertex.set(x1, y1, z1);
-    tt.v2.vertex.set(x2, y2, z2);
-    tt.v3.vertex.set(x3, y3, z3);
-
-    tt.calculateNormal();
-    tri.push_back(tt);
-}
-
 void Asteroid::setup(double size, int iter, int seed)
 {
-    std::vector<Triangle>& tri = mMesh.mTriangles;
+    mMesh->clear();
 
-    tri.clear();
-    pushTriangle(tri, 1.02, 1, 1, -1.07, -1, 1, 1.03, -1, -1);
-    pushTriangle(tri, -1.07, -1, 1, 1.02, 1, 1, -1.09, 1, -1);
-    pushTriangle(tri, 1.03, -1, -1, -1.07, -1, 1, -1.09, 1, -1);
-    pushTriangle(tri, -1.09, 1, -1, 1.02, 1, 1, 1.03, -1, -1);
+    uint32_t a = mMesh->addVertex(1.02, 1, 1);
+    uint32_t b = mMesh->addVertex(-1.07, -1, 1);
+    uint32_t c = mMesh->addVertex(1.03, -1, -1);
+    uint32_t d = mMesh->addVertex(-1.09, 1, -1);
 
-    mMesh.normalize();
+    mMesh->addTriangle(a, b, c);
+    mMesh->addTriangle(b, a, d);
+    mMesh->addTriangle(c, b, d);
+    mMesh->addTriangle(d, a, c);
+
+    mMesh->normalize();
 
     if (iter < 0) {
         iter = 2;
@@ -59,114 +53,132 @@ void Asteroid::setup(double size, int iter, int seed)
         seed = rand() + time(NULL);
     }
 
-    for (int i = 0; i < iter; i++) {
+    for (int i = 0; i < iter - 1; i++) {
         split(seed + i, .75);
     }
 
-    mMesh.smooth();
-    mMesh.normalize();
+    // the coarse mesh is the same rock one split short
+    IndexedMesh& coarse = *mCoarseMesh;
+    coarse.mVertices = mMesh->mVertices;
+    coarse.mNormals = mMesh->mNormals;
+    coarse.mTexCoords = mMesh->mTexCoords;
+    coarse.mIndices = mMesh->mIndices;
+
+    if (iter > 0) {
+        split(seed + iter - 1, .75);
+    }
+
+    mMesh->smooth();
+    mMesh->normalize();
+    mMesh->setMapMode(Mesh::CYLINDRICAL);
+    coarse.smooth();
+    coarse.normalize();
+    coarse.setMapMode(Mesh::CYLINDRICAL);
     mSize = size;
-    mMesh.setMapMode(Mesh::CYLINDRICAL);
 }
 
-inline Coord3<double> Asteroid::midpoint(Coord3<double>& p0,
-                                         Coord3<double>& p1,
-                                         Coord3<double>& bc,
+inline Coord3<double> Asteroid::midpoint(const Coord3<double>& a,
+                                         const Coord3<double>& b,
+                                         const Coord3<double>& bc,
                                          int seed, double strength)
 {
-    static Coord3<double> swap, tmp, mp;
-    bool swapped = false;
-
-    if (p0 < p1) {
-        swap = p0;
-        p0 = p1;
-        p1 = swap;
-        swapped = true;
-    }
+    // order the endpoints so the displacement doesn't depend on the
+    // winding of the face the edge was reached from
+    Coord3<double> p0 = (a < b) ? b : a;
+    Coord3<double> p1 = (a < b) ? a : b;
+    Coord3<double> c = bc, tmp, mp;
 
     mp = (p0 + p1) / 2;
 
-    float r = (distance(p0, bc) + distance(p1, bc)) / 2; // radius
+    float r = (distance(p0, c) + distance(p1, c)) / 2; // radius
     float l = distance(p0, p1); // edge length
     l *= strength;
     srand48(seed + p0.hash() + p1.hash());
     float d = drand48() - 0.5;
     tmp = mp - bc;
     mp = bc + tmp.normalize() * (r + d * l / 2);
-    if (swapped) {
-        swap = p0;
-        p0 = p1;
-        p1 = swap;
-    }
     return mp;
 }
 
+uint32_t Asteroid::edgeMidpoint(uint32_t a, uint32_t b,
+                                std::unordered_map<uint64_t, uint32_t>& edges,
+                                const Coord3<double>& bc,
+                                int seed, double strength)
+{
+    uint64_t key = (a < b) ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+
+    std::unordered_map<uint64_t, uint32_t>::iterator i = edges.find(key);
+    if (i != edges.end()) {
+        return i->second;
+    }
+
+    Coord3<double> mp = midpoint(mMesh->vertex(a), mMesh->vertex(b), bc, seed, strength);
+    uint32_t index = mMesh->addVertex(mp.x, mp.y, mp.z);
+    edges[key] = index;
+    return index;
+}
+
 void Asteroid::split(int seed, double strength)
 {
     Coord3<double> bc(0, 0, 0); // barycenter of asteroid
 
-    std::vector<Triangle>::iterator i = mMesh.mTriangles.begin();
-    for (; i != mMesh.mTriangles.end(); ++i) {
-        for (int j = 0; j < 3; j++) {
-            bc += (*i)[j].vertex;
-        }
+    const std::size_t n = mMesh->numVertices();
+    for (uint32_t i = 0; i < n; i++) {
+        bc += mMesh->vertex(i);
     }
+    bc /= n;
+
+    std::vector<uint32_t> faces;
+    faces.swap(mMesh->mIndices);
+    mMesh->mIndices.reserve(faces.size() * 4);
 
-    bc /= mMesh.mTriangles.size() * 3;
+    // every edge is shared by two faces, so a closed mesh gains one new
+    // vertex per edge
+    std::unordered_map<uint64_t, uint32_t> edges;
+    edges.reserve(faces.size() / 2);
 
-    Mesh mesh;
-    Coord3<double> mp01, mp02, mp12;
+    for (std::size_t t = 0; t < faces.size(); t += 3) {
+        uint32_t v1 = faces[t], v2 = faces[t + 1], v3 = faces[t + 2];
 
-    for (i = mMesh.mTriangles.begin(); i != mMesh.mTriangles.end(); i++) {
-        mp01 = midpoint((*i).v1.vertex, (*i).v2.vertex, bc, seed, strength);
-        mp02 = midpoint((*i).v1.vertex, (*i).v3.vertex, bc, seed, strength);
-        mp12 = midpoint((*i).v2.vertex, (*i).v3.vertex, bc, seed, strength);
+        uint32_t mp01 = edgeMidpoint(v1, v2, edges, bc, seed, strength);
+        uint32_t mp02 = edgeMidpoint(v1, v3, edges, bc, seed, strength);
+        uint32_t mp12 = edgeMidpoint(v2, v3, edges, bc, seed, strength);
 
-        mesh.mTriangles.push_back(Triangle((*i).v1.vertex, mp01, mp02));
-        mesh.mTriangles.push_back(Triangle((*i).v2.vertex, mp12, mp01));
-        mesh.mTriangles.push_back(Triangle((*i).v3.vertex, mp02, mp12));
-        mesh.mTriangles.push_back(Triangle(mp12, mp02, mp01));
+        mMesh->addTriangle(v1, mp01, mp02);
+        mMesh->addTriangle(v2, mp12, mp01);
+        mMesh->addTriangle(v3, mp02, mp12);
+        mMesh->addTriangle(mp12, mp02, mp01);
     }
-    mMesh = mesh;
 }
 
-unsigned int ASTEROID_TEXTURE = 0;
-static bool BuildTexture = true;
-
-#include "glpng.h"
-
-void Asteroid::draw()
+static void render(const Snapshot::Item& item)
 {
-    if (BuildTexture) {
-        pngInfo info;
-        glGenTextures(1, &ASTEROID_TEXTURE);
-        glBindTexture(GL_TEXTURE_2D, ASTEROID_TEXTURE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-
-        if (!pngLoad("/usr/local/share/ssc/ast.png", PNG_NOMIPMAP, PNG_SOLID, &info)) {
-            fprintf(stderr, "Can't load file\n");
-            abort();
-        }
-        BuildTexture = false;
-    }
-    mMesh.setTexture(ASTEROID_TEXTURE);
-
-    if (mFirstDraw) {
-        mDisplayList = glGenLists(1);
-        glNewList(mDisplayList, GL_COMPILE);
-        mMesh.draw();
-        glEndList();
-        mFirstDraw = false;
+    IndexedMesh& mesh = *item.mesh;
+
+    if (!mesh.mDisplayList) {
+        AssetManager& assets = AssetManager::getInstance();
+        static AssetManager::Handle texture = assets.find("ast.png");
+        mesh.setTexture(assets.texture(texture));
+        mesh.genDisplayList();
     }
 
+    float size = item.param[2];
+
     glPushMatrix();
-    glTranslated(mPosition.x, -mPosition.y, mPosition.z);
-    glRotated(DEG(rot.x), 1, 0, 0);
-    glRotated(DEG(rot.y), 0, 1, 0);
-    glScalef(mSize, mSize, mSize);
-    glCallList(mDisplayList);
+    glTranslated(item.x, -item.y, item.z);
+    glRotated(item.param[0], 1, 0, 0);
+    glRotated(item.param[1], 0, 1, 0);
+    glScalef(size, size, size);
+    mesh.drawDisplayList();
     glPopMatrix();
 }
+
+void Asteroid::record(Snapshot& snap)
+{
+    Snapshot::Item& item = snap.addItem(render);
+    item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
+    item.param[0] = DEG(rot.x);
+    item.param[1] = DEG(rot.y);
+    item.param[2] = mSize;
+    item.mesh = Quality::getInstance().coarseAsteroids() ? mCoarseMesh : mMesh;
+}
@@ -4,6 +4,9 @@
 #include "geom.h"
 #include "object.h"
 
+#include <memory>
+#include <unordered_map>
+
 class Asteroid : public ScreenObject {
 public:
     enum Size { LARGE = 20,
@@ -15,7 +18,7 @@ public:
 
     ~Asteroid() {}
 
-    void draw();
+    void record(Snapshot& snap);
 
     void move(double dt)
     {
@@ -27,19 +30,27 @@ public:
 
     void split(int seed, double strength);
 
-    Coord3<double> midpoint(Coord3<double>& p0,
-                            Coord3<double>& p1,
-                            Coord3<double>& bc,
+    Coord3<double> midpoint(const Coord3<double>& p0,
+                            const Coord3<double>& p1,
+                            const Coord3<double>& bc,
                             int seed, double strength);
 
     int points() { return 10; }
 
 private:
-    Mesh mMesh;
+    // Returns the index of the displaced midpoint of edge (a, b), creating
+    // it the first time the edge is seen so that both faces sharing the
+    // edge reuse the same vertex.
+    uint32_t edgeMidpoint(uint32_t a, uint32_t b,
+                          std::unordered_map<uint64_t, uint32_t>& edges,
+                          const Coord3<double>& bc,
+                          int seed, double strength);
+
+    // shared with the snapshots that draw it; see Snapshot::shareMesh()
+    std::shared_ptr<IndexedMesh> mMesh;
+    std::shared_ptr<IndexedMesh> mCoarseMesh; // drawn at low quality
     double mSize;
     Coord3<double> rot, rot_amt;
-    bool mFirstDraw;
-    int mDisplayList;
 };
 
 #endif // SSC_ASTEROID_H
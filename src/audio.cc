@@ -14,35 +14,235 @@
 //      http://www.reptilelabour.com/software/chromium/
 
 #include "audio.h"
+#include "asset.h"
 #include "common.h"
 #include "config.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Sounds further than this from the listener are not played at all
+const float AUDIO_HEARING_RADIUS = 1200;
+
+// How long the recorder holds a voice for one sound
+const double RECORDER_VOICE_MS = 500;
+
+// How much each sound matters when voices run short, indexed by
+// SoundType. Losing the ship outranks everything; the bogeys' gunfire is
+// the first to go.
+static const float PRIORITY[] = {
+    0.0, // UNUSED
+    0.2, // BOOM
+    1.0, // EXPLOSION
+    0.5, // EXPLO_POP
+    0.8, // LIFE_ADD
+    0.9, // LIFE_LOSE
+    0.8, // POWER
+    0.0, // MUSIC_GAME
+};
+
 // ---------------------------------------------------------------------------
 
 Audio::Audio()
+    : mHead(0)
+    , mTail(0)
+    , mListenerX(0)
+    , mListenerY(0)
 {
-    fileNames[UNUSED] = "/usr/local/share/ssc/unused.wav";
-    fileNames[BOOM] = "/usr/local/share/ssc/boom.wav";
-    fileNames[EXPLOSION] = "/usr/local/share/ssc/exploBig.wav";
-    fileNames[EXPLO_POP] = "/usr/local/share/ssc/exploPop.wav";
-    fileNames[LIFE_ADD] = "/usr/local/share/ssc/life_add.wav";
-    fileNames[LIFE_LOSE] = "/usr/local/share/ssc/life_lose.wav";
-    fileNames[POWER] = "/usr/local/share/ssc/power.wav";
-    fileNames[MUSIC_GAME] = "/usr/local/share/ssc/trance.wav";
+    // UNUSED and LIFE_ADD have no sound in the data directory
+    fileNames[UNUSED] = 0;
+    fileNames[BOOM] = "boom.wav";
+    fileNames[EXPLOSION] = "exploBig.wav";
+    fileNames[EXPLO_POP] = "exploPop.wav";
+    fileNames[LIFE_ADD] = 0;
+    fileNames[LIFE_LOSE] = "life_lose.wav";
+    fileNames[POWER] = "power.wav";
+    fileNames[MUSIC_GAME] = "trance.wav";
+
+    for (int i = 0; i < NUM_VOICES; i++) {
+        mVoices[i].type = UNUSED;
+        mVoices[i].priority = 0;
+    }
+
+    resetStats();
 }
 
 Audio::~Audio()
 {
 }
 
+Audio* Audio::create()
+{
+    Config& conf = Config::getInstance();
+    const char* backend = conf.audioBackend();
+
+    if (!strcasecmp(backend, "null")) {
+        return new AudioNull();
+    }
+    if (!strcasecmp(backend, "record")) {
+        return new AudioRecorder(conf.audioRecordFile());
+    }
+    if (strcasecmp(backend, "sdl")) {
+        fprintf(stderr, "Unknown audio backend '%s', using sdl\n", backend);
+    }
+
+    AudioSDLMixer* mixer = new AudioSDLMixer();
+    if (mixer->isOpen()) {
+        return mixer;
+    }
+
+    delete mixer;
+    return new AudioNull();
+}
+
+void Audio::resetStats()
+{
+    mCommands = mPlayed = mCoalesced = mCulled = mStolen = mDropped = 0;
+    mOverflows = 0;
+}
+
+void Audio::setListener(double x, double y)
+{
+    mListenerX = x;
+    mListenerY = y;
+}
+
+// Producer side of the ring. A full ring drops the sound rather than
+// wait for the consumer.
+
+void Audio::playSound(SoundType type, float* pos)
+{
+    unsigned int tail = mTail.load(std::memory_order_relaxed);
+
+    if (tail - mHead.load(std::memory_order_acquire) >= QUEUE_SIZE) {
+        mOverflows++;
+        return;
+    }
+
+    Command& c = mQueue[tail % QUEUE_SIZE];
+    c.type = type;
+    c.positional = pos != 0;
+    c.x = pos ? pos[0] : 0;
+    c.y = pos ? pos[1] : 0;
+
+    mTail.store(tail + 1, std::memory_order_release);
+}
+
 void Audio::update()
 {
+    struct Request {
+        SoundType type;
+        float dx, dy, distance, priority;
+    };
+
+    // At most one request per type survives the tick
+    Request pending[NUM_SOUND_TYPES];
+    bool wanted[NUM_SOUND_TYPES] = { false };
+
+    unsigned int head = mHead.load(std::memory_order_relaxed),
+                 tail = mTail.load(std::memory_order_acquire);
+
+    for (; head != tail; head++) {
+        const Command& c = mQueue[head % QUEUE_SIZE];
+        mCommands++;
+
+        float dx = 0, dy = 0;
+        if (c.positional) {
+            dx = c.x - mListenerX;
+            dy = c.y - mListenerY;
+        }
+        float distance = sqrt(dx * dx + dy * dy) / AUDIO_HEARING_RADIUS;
+
+        if (distance > 1) {
+            mCulled++;
+            continue;
+        }
+
+        Request& r = pending[c.type];
+        if (wanted[c.type]) {
+            mCoalesced++;
+            if (distance >= r.distance)
+                continue;
+        }
+
+        wanted[c.type] = true;
+        r.type = c.type;
+        r.dx = dx, r.dy = dy;
+        r.distance = distance;
+        r.priority = PRIORITY[c.type] * (1 - distance / 2);
+    }
+
+    mHead.store(head, std::memory_order_release);
+
+    Request* order[NUM_SOUND_TYPES];
+    int count = 0;
+    for (int i = 0; i < NUM_SOUND_TYPES; i++) {
+        if (wanted[i])
+            order[count++] = &pending[i];
+    }
+
+    if (count == 0)
+        return;
+
+    std::sort(order, order + count,
+              [](const Request* a, const Request* b) { return a->priority > b->priority; });
+
+    for (int v = 0; v < NUM_VOICES; v++) {
+        if (mVoices[v].type != UNUSED && !voicePlaying(v)) {
+            mVoices[v].type = UNUSED;
+            mVoices[v].priority = 0;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const Request& r = *order[i];
+
+        // a free voice if there is one, else the least important
+        int voice = 0;
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (mVoices[v].type == UNUSED) {
+                voice = v;
+                break;
+            }
+            if (mVoices[v].priority < mVoices[voice].priority)
+                voice = v;
+        }
+
+        if (mVoices[voice].type != UNUSED) {
+            if (mVoices[voice].priority >= r.priority) {
+                mDropped++;
+                continue;
+            }
+            stopVoice(voice);
+            mStolen++;
+        }
+
+        // screen y grows downwards, so "up" is -y
+        float angle = atan2(r.dx, -r.dy) * 180 / M_PI;
+        if (angle < 0)
+            angle += 360;
+
+        mVoices[voice].type = r.type;
+        mVoices[voice].priority = r.priority;
+        startVoice(voice, r.type, angle, r.distance);
+        mPlayed++;
+    }
 }
 
-void Audio::playSound(SoundType, float*, int)
+void Audio::startVoice(int, SoundType, float, float)
 {
 }
 
+void Audio::stopVoice(int)
+{
+}
+
+bool Audio::voicePlaying(int)
+{
+    return false;
+}
+
 void Audio::initSound()
 {
 }
@@ -53,39 +253,96 @@ void Audio::setSoundVolume(float)
 
 // ---------------------------------------------------------------------------
 
-SoundInfo::SoundInfo()
+AudioRecorder::AudioRecorder(const char* path)
+    : Audio()
+    , mFile(0)
+    , mStart(std::chrono::steady_clock::now())
 {
-    type = Audio::EXPLOSION;
-    pos[0] = 0.0;
-    pos[1] = 0.0;
-    pos[2] = 0.0;
-    age = 1;
-    back = next = 0;
+    if (path && *path) {
+        mFile = fopen(path, "w");
+        if (!mFile) {
+            fprintf(stderr, "Could not open audio record file %s\n", path);
+        }
+    }
+
+    for (int i = 0; i < NUM_VOICES; i++) {
+        mVoiceEnd[i] = 0;
+    }
+    for (int i = 0; i < NUM_SOUND_TYPES; i++) {
+        mCount[i] = 0;
+    }
+}
+
+AudioRecorder::~AudioRecorder()
+{
+    double seconds = now() / 1000;
+    unsigned long total = 0;
+
+    fprintf(stderr, "audio record: %.1f s\n", seconds);
+    for (int i = 0; i < NUM_SOUND_TYPES; i++) {
+        if (mCount[i] > 0) {
+            fprintf(stderr, "    %-14s %lu\n", fileNames[i] ? fileNames[i] : "-", mCount[i]);
+        }
+        total += mCount[i];
+    }
+    fprintf(stderr, "    %lu sounds, %.1f per second\n",
+            total, seconds > 0 ? total / seconds : 0);
+
+    if (mFile) {
+        fclose(mFile);
+    }
 }
 
-SoundInfo::SoundInfo(Audio::SoundType t, float p[3], int a)
+double AudioRecorder::now()
 {
-    type = t;
-    pos[0] = p[0];
-    pos[1] = p[1];
-    pos[2] = p[2];
-    age = a;
-    back = next = 0;
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - mStart;
+    return d.count();
+}
+
+void AudioRecorder::startVoice(int voice, SoundType type, float angle, float distance)
+{
+    double t = now();
+
+    mCount[type]++;
+    mVoiceEnd[voice] = t + RECORDER_VOICE_MS;
+
+    if (mFile) {
+        fprintf(mFile, "%.3f %s %d %.0f %.3f\n", t, fileNames[type] ? fileNames[type] : "-", voice, angle, distance);
+    }
+}
+
+void AudioRecorder::stopVoice(int voice)
+{
+    mVoiceEnd[voice] = 0;
+}
+
+bool AudioRecorder::voicePlaying(int voice)
+{
+    return now() < mVoiceEnd[voice];
 }
 
 // ---------------------------------------------------------------------------
 
 AudioSDLMixer::AudioSDLMixer()
     : Audio()
+    , mOpen(false)
+    , mMusic(0)
 {
     initSound();
 }
 
 AudioSDLMixer::~AudioSDLMixer()
 {
-    for (int i = 0; i < NUM_SOUND_TYPES; i++) {
-        Mix_FreeChunk(sounds[i]);
+    if (!mOpen) {
+        return;
     }
+
+    Mix_HaltChannel(-1);
+    if (mMusic) {
+        Mix_HaltMusic();
+        Mix_FreeMusic(mMusic);
+    }
+    mBank.close();
     Mix_CloseAudio();
 }
 
@@ -99,38 +356,68 @@ void AudioSDLMixer::initSound()
 
     if (Mix_OpenAudio(22050, AUDIO_S16, 2, 512) < 0) {
         fprintf(stderr,
-                "Could not initialize SDL mixer: %s\n",
+                "Could not initialize SDL mixer, continuing without sound: %s\n",
                 SDL_GetError());
-        exit(1);
+        return;
     }
+    mOpen = true;
 
-    for (int i = 0; i < NUM_SOUND_TYPES; i++) {
-        sounds[i] = Mix_LoadWAV(fileNames[i]);
-    }
+    Mix_AllocateChannels(NUM_VOICES);
 
-    Mix_ReserveChannels(1);
-    Mix_PlayChannel(0, sounds[MUSIC_GAME], -1);
+    // the effects come from the bank; the music is not part of it
+    if (conf.playSound()) {
+        const char* effects[NUM_SOUND_TYPES];
+        for (int i = 0; i < NUM_SOUND_TYPES; i++) {
+            effects[i] = fileNames[i];
+        }
+        effects[MUSIC_GAME] = 0;
+        mBank.open(effects, NUM_SOUND_TYPES);
+    }
 
+    // SDL_mixer decodes the music a buffer at a time from the file as it
+    // plays, on its own thread
     if (conf.playMusic()) {
-        Mix_Volume(0, (int)(MIX_MAX_VOLUME * conf.musicVol()));
-    } else {
-        Mix_Volume(0, 0);
+        AssetManager& assets = AssetManager::getInstance();
+        mMusic = Mix_LoadMUS(assets.path(assets.find(fileNames[MUSIC_GAME])));
+        if (mMusic) {
+            Mix_VolumeMusic((int)(MIX_MAX_VOLUME * conf.musicVol()));
+            Mix_PlayMusic(mMusic, -1);
+        } else {
+            fprintf(stderr, "Could not load music: %s\n", SDL_GetError());
+        }
     }
 
     // atexit(Mix_CloseAudio);
 }
 
-void AudioSDLMixer::playSound(SoundType type, float pos[3], int)
+// Voice n plays on channel n
+
+void AudioSDLMixer::startVoice(int voice, SoundType type, float angle, float distance)
+{
+    Mix_Chunk* chunk = mOpen ? mBank.chunk(type) : 0;
+
+    if (Config::getInstance().playSound() && chunk) {
+        Mix_SetPosition(voice, (Sint16)angle, (Uint8)(distance * 255));
+        Mix_PlayChannel(voice, chunk, 0);
+    }
+}
+
+void AudioSDLMixer::stopVoice(int voice)
 {
-    if (Config::getInstance().playSound()) {
-        Mix_PlayChannel(-1, sounds[type], 0);
+    if (mOpen) {
+        Mix_HaltChannel(voice);
     }
 }
 
+bool AudioSDLMixer::voicePlaying(int voice)
+{
+    return mOpen && Mix_Playing(voice) != 0;
+}
+
 void AudioSDLMixer::setSoundVolume(float value)
 {
-    if (Config::getInstance().playSound()) {
-        for (int i = 1; i < MIX_CHANNELS; i++) {
+    if (mOpen && Config::getInstance().playSound()) {
+        for (int i = 0; i < NUM_VOICES; i++) {
             Mix_Volume(i, (int)(MIX_MAX_VOLUME * value));
         }
     }
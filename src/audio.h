@@ -16,6 +16,30 @@
 #ifndef SSC_AUDIO_H
 #define SSC_AUDIO_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: Audio
+//
+// Sounds are not played where they are asked for. playSound() only puts a
+// command on a fixed size single producer, single consumer ring, which is
+// safe to call from collision callbacks; update() drains it once a tick.
+//
+// While draining, every request for the same sound in one tick collapses
+// into the one nearest the listener, sounds too far from the listener are
+// dropped, and what is left is ranked by a per-type priority scaled by
+// distance. The survivors are handed out over a fixed pool of voices. A
+// sound that finds no free voice takes the one playing the least
+// important sound, if that is less important than itself; otherwise it
+// is dropped.
+//
+// A null position means the sound is at the listener.
+//
+// --------------------------------------------------------------------------
+
 class Audio {
 public:
     enum SoundType {
@@ -30,46 +54,136 @@ public:
         NUM_SOUND_TYPES
     };
 
+    enum { NUM_VOICES = 8,
+           QUEUE_SIZE = 256 };
+
     Audio();
     virtual ~Audio();
 
-    virtual void update();
-    virtual void playSound(SoundType type, float* pos, int age = 0);
+    // The backend named by [audio] backend: "sdl" (the default), "null"
+    // or "record". Falls back to the null backend when the sound device
+    // cannot be opened.
+    static Audio* create();
+
+    void update();
+    void playSound(SoundType type, float* pos);
+    void setListener(double x, double y);
     virtual void setSoundVolume(float);
 
+    unsigned long commands() { return mCommands; }
+    unsigned long played() { return mPlayed; }
+    unsigned long coalesced() { return mCoalesced; }
+    unsigned long culled() { return mCulled; }
+    unsigned long stolen() { return mStolen; }
+    unsigned long dropped() { return mDropped; }
+    unsigned long overflows() { return mOverflows; }
+    void resetStats();
+
 protected:
     virtual void initSound();
 
+    // Backend hooks. A voice is started with an angle in degrees
+    // clockwise from straight up the screen and a distance from 0 (at the
+    // listener) to 1 (at the edge of hearing).
+    virtual void startVoice(int voice, SoundType type, float angle, float distance);
+    virtual void stopVoice(int voice);
+    virtual bool voicePlaying(int voice);
+
     const char* fileNames[NUM_SOUND_TYPES];
+
+private:
+    struct Command {
+        SoundType type;
+        float x, y;
+        bool positional;
+    };
+
+    struct Voice {
+        SoundType type;
+        float priority;
+    };
+
+    Command mQueue[QUEUE_SIZE];
+    std::atomic<unsigned int> mHead, mTail;
+
+    Voice mVoices[NUM_VOICES];
+    double mListenerX, mListenerY;
+
+    unsigned long mCommands;
+    unsigned long mPlayed;
+    unsigned long mCoalesced;
+    unsigned long mCulled;
+    unsigned long mStolen;
+    unsigned long mDropped;
+    std::atomic<unsigned long> mOverflows;
 };
 
-class SoundInfo {
+// --------------------------------------------------------------------------
+//
+// CLASS: AudioNull
+//
+// Runs the whole command queue, with nothing behind it. Every voice is
+// finished as soon as it starts.
+//
+// --------------------------------------------------------------------------
+
+class AudioNull : public Audio {
+};
+
+// --------------------------------------------------------------------------
+//
+// CLASS: AudioRecorder
+//
+// A device-less backend for soak and benchmark runs. Each sound that gets
+// a voice is counted and, if [audio] record_file is set, written there as
+// a line of milliseconds since start, sound, voice, angle and distance.
+// Voices are held for a nominal length so voice stealing behaves as it
+// would on a device. A summary goes to stderr on destruction.
+//
+// --------------------------------------------------------------------------
+
+class AudioRecorder : public Audio {
 public:
-    SoundInfo();
-    SoundInfo(Audio::SoundType t, float p[3], int a);
-
-    Audio::SoundType type;
-    float pos[3];
-    int age;
-    SoundInfo* next;
-    SoundInfo* back;
+    AudioRecorder(const char* path);
+    ~AudioRecorder();
+
+protected:
+    void startVoice(int voice, SoundType type, float angle, float distance);
+    void stopVoice(int voice);
+    bool voicePlaying(int voice);
+
+private:
+    double now();
+
+    FILE* mFile;
+    std::chrono::steady_clock::time_point mStart;
+    double mVoiceEnd[NUM_VOICES];
+    unsigned long mCount[NUM_SOUND_TYPES];
 };
 
-#include <SDL/SDL_mixer.h>
+#include "soundbank.h"
 
 class AudioSDLMixer : public Audio {
 public:
     AudioSDLMixer();
     ~AudioSDLMixer();
 
-    void playSound(SoundType type, float* pos, int age = 0);
     void setSoundVolume(float);
 
+    // false if the device could not be opened or all audio is off
+    bool isOpen() { return mOpen; }
+
 protected:
     void initSound();
 
+    void startVoice(int voice, SoundType type, float angle, float distance);
+    void stopVoice(int voice);
+    bool voicePlaying(int voice);
+
 private:
-    Mix_Chunk* sounds[NUM_SOUND_TYPES];
+    bool mOpen;
+    SoundBank mBank;
+    Mix_Music* mMusic;
 };
 
 #endif // SSC_AUDIO_H
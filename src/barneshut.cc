@@ -0,0 +1,271 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "barneshut.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Keeps the force finite when a body passes through a source.
+const double GRAVITY_SOFTENING = 40.0;
+
+// A cell is treated as one mass when its width is less than THETA times
+// its distance from the body.
+const double GRAVITY_THETA = 0.5;
+
+// Coincident sources are merged rather than split forever.
+const int GRAVITY_MAX_DEPTH = 20;
+
+// Below this many bodies the force pass stays on the calling thread.
+const std::size_t GRAVITY_PARALLEL_BODIES = 2048;
+
+const unsigned int GRAVITY_MAX_THREADS = 8;
+
+BarnesHut::BarnesHut()
+    : mJob(0)
+    , mThreads(1)
+    , mPending(0)
+    , mChunk(0)
+    , mQuit(false)
+{
+}
+
+BarnesHut::~BarnesHut()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mStart.notify_all();
+
+    for (std::size_t t = 0; t < mWorkers.size(); t++)
+        mWorkers[t].join();
+}
+
+void BarnesHut::clear()
+{
+    mNodes.clear();
+    mSources.clear();
+    mBodies.clear();
+}
+
+void BarnesHut::addSource(double x, double y, double mass)
+{
+    Source s = { x, y, mass };
+    mSources.push_back(s);
+}
+
+std::size_t BarnesHut::addBody(double x, double y, double scale)
+{
+    Body b = { x, y, scale, 0, 0 };
+    mBodies.push_back(b);
+    return mBodies.size() - 1;
+}
+
+// ------------------------------------------------------------------
+//
+// Quadtree construction
+//
+// ------------------------------------------------------------------
+
+void BarnesHut::build()
+{
+    mNodes.clear();
+
+    if (mSources.empty())
+        return;
+
+    double x0 = mSources[0].x, y0 = mSources[0].y, x1 = x0, y1 = y0;
+
+    for (std::size_t i = 1; i < mSources.size(); i++) {
+        const Source& s = mSources[i];
+        x0 = std::min(x0, s.x), x1 = std::max(x1, s.x);
+        y0 = std::min(y0, s.y), y1 = std::max(y1, s.y);
+    }
+
+    Node root;
+    root.x = (x0 + x1) / 2;
+    root.y = (y0 + y1) / 2;
+    root.half = std::max(std::max(x1 - x0, y1 - y0) / 2, 1.0);
+    root.mass = root.cx = root.cy = 0;
+    std::fill(root.child, root.child + 4, -1);
+    root.depth = 0;
+    root.leaf = true;
+    mNodes.push_back(root);
+
+    for (std::size_t i = 0; i < mSources.size(); i++)
+        insert(0, mSources[i].x, mSources[i].y, mSources[i].mass);
+}
+
+// Indices rather than references throughout, since adding a child may
+// reallocate mNodes.
+
+void BarnesHut::insert(int node, double x, double y, double mass)
+{
+    for (;;) {
+        Node& n = mNodes[node];
+
+        if (n.leaf && (n.mass == 0 || n.depth == GRAVITY_MAX_DEPTH)) {
+            n.cx = (n.cx * n.mass + x * mass) / (n.mass + mass);
+            n.cy = (n.cy * n.mass + y * mass) / (n.mass + mass);
+            n.mass += mass;
+            return;
+        }
+
+        if (n.leaf) {
+            // push the source already here down a level first
+            double ox = n.cx, oy = n.cy, omass = n.mass;
+            n.leaf = false;
+            insert(child(node, (ox >= n.x) | ((oy >= n.y) << 1)), ox, oy, omass);
+        }
+
+        Node& m = mNodes[node];
+        m.cx = (m.cx * m.mass + x * mass) / (m.mass + mass);
+        m.cy = (m.cy * m.mass + y * mass) / (m.mass + mass);
+        m.mass += mass;
+
+        node = child(node, (x >= m.x) | ((y >= m.y) << 1));
+    }
+}
+
+int BarnesHut::child(int node, int quadrant)
+{
+    if (mNodes[node].child[quadrant] >= 0)
+        return mNodes[node].child[quadrant];
+
+    const Node& parent = mNodes[node];
+    Node c;
+    c.half = parent.half / 2;
+    c.x = parent.x + ((quadrant & 1) ? c.half : -c.half);
+    c.y = parent.y + ((quadrant & 2) ? c.half : -c.half);
+    c.mass = c.cx = c.cy = 0;
+    std::fill(c.child, c.child + 4, -1);
+    c.depth = parent.depth + 1;
+    c.leaf = true;
+
+    int index = mNodes.size();
+    mNodes.push_back(c);
+    mNodes[node].child[quadrant] = index;
+    return index;
+}
+
+// ------------------------------------------------------------------
+//
+// Force evaluation
+//
+// ------------------------------------------------------------------
+
+void BarnesHut::evaluate()
+{
+    if (mNodes.empty()) {
+        for (std::size_t n = 0; n < mBodies.size(); n++)
+            mBodies[n].fx = mBodies[n].fy = 0;
+        mThreads = 1;
+        return;
+    }
+
+    unsigned int threads = 1;
+    if (mBodies.size() >= GRAVITY_PARALLEL_BODIES) {
+        startWorkers();
+        threads = mWorkers.size() + 1;
+    }
+
+    if (threads == 1) {
+        mThreads = 1;
+        field(0, mBodies.size());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mThreads = threads;
+        mChunk = (mBodies.size() + threads - 1) / threads;
+        mPending = threads - 1;
+        mJob++;
+    }
+    mStart.notify_all();
+
+    field(0, std::min(mBodies.size(), mChunk));
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mPending == 0; });
+}
+
+void BarnesHut::startWorkers()
+{
+    if (!mWorkers.empty())
+        return;
+
+    unsigned int threads = std::min(GRAVITY_MAX_THREADS, std::thread::hardware_concurrency());
+    for (unsigned int t = 1; t < threads; t++)
+        mWorkers.push_back(std::thread(&BarnesHut::work, this, t));
+}
+
+void BarnesHut::work(unsigned int index)
+{
+    unsigned long seen = 0;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mStart.wait(lock, [this, seen] { return mQuit || mJob != seen; });
+        if (mQuit)
+            return;
+        seen = mJob;
+
+        std::size_t begin = index * mChunk, end = std::min(mBodies.size(), begin + mChunk);
+
+        lock.unlock();
+        if (begin < end)
+            field(begin, end);
+        lock.lock();
+
+        if (--mPending == 0)
+            mDone.notify_one();
+    }
+}
+
+void BarnesHut::field(Body& b) const
+{
+    int stack[3 * GRAVITY_MAX_DEPTH + 4];
+    int top = 0;
+
+    b.fx = b.fy = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& n = mNodes[stack[--top]];
+
+        if (n.mass == 0)
+            continue;
+
+        double dx = n.cx - b.x, dy = n.cy - b.y,
+               d2 = dx * dx + dy * dy;
+        double width = n.half * 2;
+
+        if (n.leaf || width * width < GRAVITY_THETA * GRAVITY_THETA * d2) {
+            double r2 = d2 + GRAVITY_SOFTENING * GRAVITY_SOFTENING;
+            double f = b.scale * n.mass / (r2 * sqrt(r2));
+            b.fx += dx * f;
+            b.fy += dy * f;
+            continue;
+        }
+
+        for (int q = 0; q < 4; q++) {
+            if (n.child[q] >= 0)
+                stack[top++] = n.child[q];
+        }
+    }
+}
+
+void BarnesHut::field(std::size_t begin, std::size_t end)
+{
+    for (std::size_t n = begin; n < end; n++)
+        field(mBodies[n]);
+}
@@ -0,0 +1,100 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_BARNESHUT_H
+#define SSC_BARNESHUT_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: BarnesHut
+//
+// The gravity field of a set of point masses, on plain positions so it
+// can be driven by the game (see Gravity) or by gravity_bench alike.
+// build() collects the sources into a quadtree, each cell holding its
+// total mass and centre of mass; evaluate() then walks the tree once for
+// each body, treating distant cells as a single mass.
+//
+// The tree is only read during evaluate(), so large body counts are
+// split across a pool of worker threads, started on first use and kept
+// for the life of the object.
+//
+// --------------------------------------------------------------------------
+
+class BarnesHut {
+public:
+    BarnesHut();
+    ~BarnesHut();
+
+    void clear();
+    void addSource(double x, double y, double mass);
+
+    // scale multiplies the force on the body; its index is the order added
+    std::size_t addBody(double x, double y, double scale);
+
+    void build();
+    void evaluate();
+
+    double fx(std::size_t body) const { return mBodies[body].fx; }
+    double fy(std::size_t body) const { return mBodies[body].fy; }
+
+    std::size_t sources() const { return mSources.size(); }
+    std::size_t bodies() const { return mBodies.size(); }
+    std::size_t nodes() const { return mNodes.size(); }
+
+    // threads used by the last evaluate(), the caller's included
+    unsigned int threads() const { return mThreads; }
+
+private:
+    struct Node {
+        double x, y, half; // square cell
+        double mass, cx, cy; // total mass and its centre
+        int child[4]; // -1 if absent
+        int depth;
+        bool leaf;
+    };
+
+    struct Source {
+        double x, y, mass;
+    };
+
+    struct Body {
+        double x, y, scale;
+        double fx, fy;
+    };
+
+    void insert(int node, double x, double y, double mass);
+    int child(int node, int quadrant);
+    void field(Body& b) const;
+    void field(std::size_t begin, std::size_t end);
+
+    void startWorkers();
+    void work(unsigned int index);
+
+    std::vector<Node> mNodes;
+    std::vector<Source> mSources;
+    std::vector<Body> mBodies;
+
+    // the pool; worker n takes chunk n of each job, the caller chunk 0
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mStart, mDone;
+    unsigned long mJob;
+    unsigned int mThreads, mPending;
+    std::size_t mChunk;
+    bool mQuit;
+};
+
+#endif // SSC_BARNESHUT_H
@@ -11,6 +11,7 @@
 #include "blackhole.h"
 #include "draw.h"
 #include "graph.h"
+#include "snapshot.h"
 
 BlackHole::BlackHole(double x, double y)
     : ScreenObject(BLACKHOLE_TYPE, BLACKHOLE_RADIUS, BLACKHOLE_MASS, 0,
@@ -27,8 +28,10 @@ BlackHole::~BlackHole()
 {
 }
 
-void BlackHole::draw()
+void BlackHole::record(Snapshot& snap)
 {
-    draw::setColor(r, g, b, 1.0);
-    draw::sphere(mPosition, radius);
+    Snapshot::Item& item = snap.addItem(Snapshot::sphere);
+    item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
+    item.r = r, item.g = g, item.b = b;
+    item.radius = radius;
 }
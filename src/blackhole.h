@@ -31,7 +31,7 @@ public:
     void move() {}
     bool collision(ScreenObject&) { return false; }
     void bounce(double, double, double, int, double) {}
-    void draw();
+    void record(Snapshot& snap);
 };
 
 #endif // SSC_BLACKHOLE_H
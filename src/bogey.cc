@@ -12,12 +12,13 @@
 #include "draw.h"
 #include "global.h"
 #include "model.h"
+#include "particle.h"
 #include "screen.h"
+#include "snapshot.h"
 
 using namespace std;
 
 unsigned int Bogey::num_alive;
-static float pos[3] = { 0.0, 0.0, 0.0 };
 
 inline void calcRotationPoints(double* x, double* y, double rot, int radius)
 {
@@ -44,14 +45,6 @@ Bogey::Bogey(double x, double y, double z)
     setState(ALIVE);
     num_alive++;
     r = g = 0, b = 1;
-    if (BOGEY == -1) {
-        BOGEY = glGenLists(1);
-        glNewList(BOGEY, GL_COMPILE);
-        GLUquadricObj* m = gluNewQuadric();
-        gluSphere(m, radius, radius + 3, 10);
-        gluDeleteQuadric(m);
-        glEndList();
-    }
 }
 
 Bogey::~Bogey()
@@ -83,8 +76,16 @@ extern bool mKill;
 
 void Bogey::move(double dt)
 {
+    // shaded by the shield; done here rather than in draw() so it stays
+    // current while the bogey is out of view
+    float strength = shield.getStrength();
+    r = 1 - strength;
+    g = 0;
+    b = strength / 1.25;
+
     if (mKill && isAlive() && onScreen()) {
         setState(DYING);
+        float pos[3] = { (float)mPosition.x, (float)mPosition.y, 0 };
         Global::audio->playSound(Audio::EXPLO_POP, pos);
         r = g = 0;
         b = 1;
@@ -119,59 +120,49 @@ void Bogey::move(double dt)
     }
 }
 
-extern bool mDrawP;
-
 void Bogey::accelerate(double amt)
 {
-    if (mDrawP) {
-        for (int i = 0; i < (rand() % 30); i++) {
-            float p = RAD((rand() % 61) - 30);
-            double r, g, b;
-            r = 1;
-            g = (double)(rand() % 80) / 100;
-            b = (double)(rand() % 30) / 100;
-            double t = (double)((rand() % 120)) / 5.0;
-            addParticle(mPosition.x - radius * sin(rotation) + ((rand() % 7) - 3),
-                        mPosition.y + radius * cos(rotation) + ((rand() % 7) - 3),
-                        mPosition.z + (rand() % 7) - 3,
-                        -sin(rotation + p) * mMaxSpeed * .5,
-                        cos(rotation + p) * mMaxSpeed * .5,
-                        sin(p) * mMaxSpeed * .5,
-                        r, g, b, t);
-        }
-    }
+    ParticleSystem& particles = ParticleSystem::getInstance();
+    particles.emit(particles.thruster(), *this, mMaxSpeed, mMaxSpeed);
     ScreenObject::accelerate(amt);
 }
 
 extern bool mDrawBLINE;
 
-void Bogey::draw()
+static void render(const Snapshot::Item& item)
 {
-    float strength = shield.getStrength();
-    r = 1 - strength;
-    g = 0;
-    b = strength / 1.25;
+    if (BOGEY == -1) {
+        BOGEY = glGenLists(1);
+        glNewList(BOGEY, GL_COMPILE);
+        GLUquadricObj* m = gluNewQuadric();
+        gluSphere(m, BOGEY_SHIELD_RADIUS, BOGEY_SHIELD_RADIUS + 3, 10);
+        gluDeleteQuadric(m);
+        glEndList();
+    }
+
+    glPushMatrix();
+    glTranslated(item.x, -item.y, item.z);
+    draw::setColor(item.r, item.g, item.b, item.a);
+    glCallList(BOGEY);
+    glPopMatrix();
+}
 
+void Bogey::record(Snapshot& snap)
+{
     if (getState() == ALIVE) {
-        glPushMatrix();
-        glTranslated(mPosition.x, -mPosition.y, mPosition.z);
+        Snapshot::Item& item = snap.addItem(render);
+        item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
         if (mDrawBLINE && !mFlock)
-            draw::setColor(.2, .2, .2);
+            item.r = item.g = item.b = .2;
         else
-            draw::setColor(r, g, b, 1.0);
-        glCallList(BOGEY);
-        glPopMatrix();
-    } else if (getState() == DYING) {
-        if (explosion.finished)
-            setState(DEAD);
-        explosion.draw();
+            item.r = r, item.g = g, item.b = b;
     }
     if (mDrawBLINE) {
-        static Coord3<double> ray_pos;
-        draw::setColor(r, g, b, .5);
         for (unsigned int i = 0; i < BOGEY_NUM_EYES; ++i) {
-            ray_pos.set(lx[i], ly[i], mPosition.z);
-            draw::sphere(ray_pos, radius);
+            Snapshot::Item& eye = snap.addItem(Snapshot::sphere);
+            eye.x = lx[i], eye.y = ly[i], eye.z = mPosition.z;
+            eye.r = r, eye.g = g, eye.b = b, eye.a = .5;
+            eye.radius = radius;
         }
     }
 }
@@ -194,12 +185,13 @@ void Bogey::fire(double dt)
 
     double error = 0;
 
-    (void)new Missile(BOGEY_TYPE, directionToShip + error,
-                      mPosition.x + (radius + 5) * sin(directionToShip + error),
-                      mPosition.y - (radius + 5) * cos(directionToShip + error),
-                      mPosition.z,
-                      mVelocity.x, mVelocity.y, mVelocity.z);
+    Missiles::getInstance().fire(BOGEY_TYPE, directionToShip + error,
+                                 mPosition.x + (radius + 5) * sin(directionToShip + error),
+                                 mPosition.y - (radius + 5) * cos(directionToShip + error),
+                                 mPosition.z,
+                                 mVelocity.x, mVelocity.y, mVelocity.z);
 
+    float pos[3] = { (float)mPosition.x, (float)mPosition.y, 0 };
     Global::audio->playSound(Audio::BOOM, pos);
 }
 
@@ -217,6 +209,7 @@ void Bogey::damage(double amt)
                 mRay[i]->disable();
             setState(DYING);
             disable();
+            float pos[3] = { (float)mPosition.x, (float)mPosition.y, 0 };
             Global::audio->playSound(Audio::EXPLO_POP, pos);
             r = g = 0;
             b = .80;
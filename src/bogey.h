@@ -33,12 +33,14 @@ public:
 
     static unsigned int num_alive;
 
-    void draw();
+    void record(Snapshot& snap);
     void fire(double dt);
     void move(double dt);
     void accelerate(double dt);
 
     bool collision(ScreenObject& obj);
+    void collided(ScreenObject& obj, const CollisionEvent& e);
+    bool shot(ObjectType owner);
     void damage(double amt);
 
     void rotate(double amt);
@@ -2,6 +2,9 @@
 #include "global.h"
 #include "screen.h"
 
+#include <algorithm>
+#include <cmath>
+
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #include <OpenGL/gl.h>
@@ -36,6 +39,113 @@ void Camera::apply()
     Global::normal.set(-mUp);
 }
 
+// Corners 0-3 are on the near plane and 4-7 on the far one, each set
+// going round the rectangle in the same order.
+
+void Camera::frustum(Frustum& f)
+{
+    Coord3<double> forward, side, up;
+
+    forward = mView - mPosition;
+    forward.normalize();
+    side = forward ^ mUp;
+    side.normalize();
+    up = side ^ forward;
+
+    double tanHalf = tan(Screen::fieldOfView() * M_PI / 360),
+           depth[2] = { Screen::zNear(), Screen::zFar() };
+
+    for (int n = 0; n < 2; n++) {
+        double h = depth[n] * tanHalf, w = h * Screen::aspectRatio();
+        Coord3<double> center = mPosition + forward * depth[n];
+
+        f.corner[n * 4 + 0] = center + up * h - side * w;
+        f.corner[n * 4 + 1] = center + up * h + side * w;
+        f.corner[n * 4 + 2] = center - up * h + side * w;
+        f.corner[n * 4 + 3] = center - up * h - side * w;
+    }
+
+    // three corners on each face
+    static const int FACES[6][3] = {
+        { 0, 1, 2 }, // near
+        { 4, 7, 6 }, // far
+        { 0, 3, 7 }, // left
+        { 1, 5, 6 }, // right
+        { 0, 4, 5 }, // top
+        { 3, 2, 6 }, // bottom
+    };
+
+    Coord3<double> inside = mPosition + forward * ((depth[0] + depth[1]) / 2);
+
+    for (int n = 0; n < 6; n++) {
+        Coord3<double> a = f.corner[FACES[n][0]],
+                       b = f.corner[FACES[n][1]],
+                       c = f.corner[FACES[n][2]];
+        Coord3<double> normal = (b - a) ^ (c - a);
+        normal.normalize();
+
+        double d = -normal.dot(a);
+        if (normal.dot(inside) + d < 0) {
+            normal = -normal;
+            d = -d;
+        }
+
+        f.plane[n][0] = normal.x;
+        f.plane[n][1] = normal.y;
+        f.plane[n][2] = normal.z;
+        f.plane[n][3] = d;
+    }
+}
+
+// The frustum cut by the slab is a convex solid whose corners are the
+// frustum's own corners inside the slab and the points where its twelve
+// edges cross the slab's faces.
+
+bool Frustum::bounds(double zmin, double zmax,
+                     double* x0, double* y0, double* x1, double* y1) const
+{
+    static const int EDGES[12][2] = {
+        { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+        { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+    };
+
+    bool any = false;
+
+    auto add = [&](double x, double y) {
+        if (!any) {
+            *x0 = *x1 = x, *y0 = *y1 = y;
+            any = true;
+        } else {
+            *x0 = std::min(*x0, x), *x1 = std::max(*x1, x);
+            *y0 = std::min(*y0, y), *y1 = std::max(*y1, y);
+        }
+    };
+
+    for (int n = 0; n < 8; n++) {
+        if (corner[n].z >= zmin && corner[n].z <= zmax)
+            add(corner[n].x, corner[n].y);
+    }
+
+    for (int n = 0; n < 12; n++) {
+        const Coord3<double>& a = corner[EDGES[n][0]];
+        const Coord3<double>& b = corner[EDGES[n][1]];
+        double dz = b.z - a.z;
+
+        if (dz == 0)
+            continue;
+
+        double planes[2] = { zmin, zmax };
+        for (int p = 0; p < 2; p++) {
+            double t = (planes[p] - a.z) / dz;
+            if (t > 0 && t < 1)
+                add(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+        }
+    }
+
+    return any;
+}
+
 void Camera::set(double px, double py, double pz,
                  double vx, double vy, double vz,
                  double ux, double uy, double uz)
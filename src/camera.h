@@ -3,6 +3,37 @@
 
 #include "coord.h"
 
+// --------------------------------------------------------------------------
+//
+// CLASS: Frustum
+//
+// The volume the camera sees, as six planes facing inwards, in GL world
+// coordinates (where game y is negated).
+//
+// --------------------------------------------------------------------------
+
+struct Frustum {
+    // plane n is a x + b y + c z + d >= 0 inside
+    double plane[6][4];
+    Coord3<double> corner[8];
+
+    // false only if the sphere is wholly outside
+    bool sphere(double x, double y, double z, double r) const
+    {
+        for (int n = 0; n < 6; n++) {
+            const double* p = plane[n];
+            if (p[0] * x + p[1] * y + p[2] * z + p[3] < -r)
+                return false;
+        }
+        return true;
+    }
+
+    // Bounding rectangle of the part of the frustum between zmin and zmax.
+    // Returns false if none of it is.
+    bool bounds(double zmin, double zmax,
+                double* x0, double* y0, double* x1, double* y1) const;
+};
+
 class Camera {
 public:
     enum Mode {
@@ -19,6 +50,9 @@ public:
     void update(double dt);
     void cycle();
 
+    // the frustum of the view set by the last apply()
+    void frustum(Frustum& f);
+
     void set(double px, double py, double pz, // position
              double vx, double vy, double vz, // view
              double ux, double uy, double uz); // up
@@ -115,6 +115,14 @@ public:
             mConfig->mColorDepth = getUnsigned();
         } else if (identIs("fullscreen")) {
             mConfig->mFullScreen = getBool();
+        } else if (identIs("sdf_text")) {
+            mConfig->mSdfText = getBool();
+        } else if (identIs("radar_rate")) {
+            mConfig->mRadarRate = getUnsigned();
+        } else if (identIs("render_thread")) {
+            mConfig->mRenderThread = getBool();
+        } else if (identIs("frame_budget")) {
+            mConfig->mFrameBudget = getDouble();
         } else {
             error();
         }
@@ -126,6 +134,8 @@ public:
             mConfig->mGameArea.x = getUnsigned();
         } else if (identIs("height")) {
             mConfig->mGameArea.x = getUnsigned();
+        } else if (identIs("data_dir")) {
+            mConfig->mDataDir = mValue;
         } else {
             error();
         }
@@ -154,6 +164,21 @@ public:
             mConfig->mSoundVol = getDouble();
         } else if (identIs("music_volume")) {
             mConfig->mMusicVol = getDouble();
+        } else if (identIs("backend")) {
+            mConfig->mAudioBackend = mValue;
+        } else if (identIs("record_file")) {
+            mConfig->mAudioRecordFile = mValue;
+        } else {
+            error();
+        }
+    }
+
+    void applyPhysics()
+    {
+        if (identIs("threads")) {
+            mConfig->mPhysicsThreads = getUnsigned();
+        } else if (identIs("planar")) {
+            mConfig->mPlanarPhysics = getBool();
         } else {
             error();
         }
@@ -169,6 +194,8 @@ public:
             applyCamera();
         } else if (sectionIs("audio")) {
             applyAudio();
+        } else if (sectionIs("physics")) {
+            applyPhysics();
         } else {
             error();
         }
@@ -274,8 +301,15 @@ Config::Config()
     , mPlayMusic(false)
     , mSoundVol(.2)
     , mMusicVol(1)
+    , mAudioBackend("sdl")
+    , mPhysicsThreads(0)
+    , mPlanarPhysics(false)
     , mColorDepth(24)
     , mFullScreen(false)
+    , mSdfText(false)
+    , mRadarRate(10)
+    , mRenderThread(true)
+    , mFrameBudget(20)
 {
     ConfigParser(this);
 }
@@ -4,6 +4,8 @@
 #include "common.h"
 #include "coord.h"
 
+#include <string>
+
 class Config {
     // ------------------------------------------------------------------
     //
@@ -45,6 +47,11 @@ public:
     Coord2<int> getGameArea() { return mGameArea; }
     unsigned int getColorDepth() { return mColorDepth; }
     bool fullscreen() { return mFullScreen; }
+    bool sdfText() { return mSdfText; }
+    unsigned int radarRate() { return mRadarRate; }
+    bool renderThread() { return mRenderThread; }
+    double frameBudget() { return mFrameBudget; } // ms, 0 holds full quality
+    const char* getDataDir() { return mDataDir.c_str(); }
 
     // camera
     double getFOV() { return mFOV; }
@@ -56,6 +63,12 @@ public:
     bool playMusic() { return mPlayMusic; }
     double soundVol() { return mSoundVol; }
     double musicVol() { return mMusicVol; }
+    const char* audioBackend() { return mAudioBackend.c_str(); }
+    const char* audioRecordFile() { return mAudioRecordFile.c_str(); }
+
+    // physics
+    unsigned int physicsThreads() { return mPhysicsThreads; }
+    bool planarPhysics() { return mPlanarPhysics; }
 
 private:
     // ------------------------------------------------------------------
@@ -68,8 +81,16 @@ private:
     double mFOV, mZNear, mZFar;
     bool mPlaySound, mPlayMusic;
     double mSoundVol, mMusicVol;
+    std::string mAudioBackend, mAudioRecordFile;
+    unsigned int mPhysicsThreads;
+    bool mPlanarPhysics;
     unsigned int mColorDepth;
     bool mFullScreen;
+    bool mSdfText;
+    unsigned int mRadarRate;
+    bool mRenderThread;
+    double mFrameBudget;
+    std::string mDataDir;
 };
 
 #endif // SSC_CONFIG_H
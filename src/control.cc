@@ -13,7 +13,7 @@
 #include "hud.h"
 #include "model.h"
 
-static SDL_Event event;
+#include <chrono>
 
 bool mGodMode = false,
      mKill = false,
@@ -36,12 +36,6 @@ void Controller::keyUp(int keysym)
     case SDLK_PAUSE:
         mPause = !mPause;
         break;
-    case SDLK_r:
-        HUD::getInstance().toggleRadar();
-        break;
-    case SDLK_c:
-        Model::getInstance().cycleCameraView();
-        break;
     case SDLK_s:
         mSlowMo = !mSlowMo;
         break;
@@ -72,47 +66,105 @@ void Controller::keyUp(int keysym)
     }
 }
 
-void Controller::poll(double dt)
+// SDL 1.2 has no event of its own for this
+const Uint8 WAKE_EVENT = SDL_USEREVENT;
+
+bool Controller::pump(bool wait)
 {
-    while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-        case SDL_QUIT:
-            mQuit = true;
-            return;
-        case SDL_KEYDOWN:
-            if (event.key.keysym.sym == SDLK_ESCAPE) {
-                mQuit = true;
-                return;
-            } else if (event.key.keysym.sym == SDLK_F1) {
-                SDL_WM_ToggleFullScreen(SDL_GetVideoSurface());
-            } else {
-                mHandler->pressKey(event.key.keysym.sym);
-            }
-            break;
-        case SDL_KEYUP:
-            keyUp(event.key.keysym.sym);
-            break;
-
-        case SDL_MOUSEMOTION:
-            mHandler->mouseMotion(event.motion.x, event.motion.y);
-            break;
-
-        case SDL_MOUSEBUTTONDOWN:
-            mHandler->pressMouseButton(event.button.button);
-            mHandler->mouseMotion(event.button.x, event.button.y);
-            break;
-        case SDL_MOUSEBUTTONUP:
-            mHandler->releaseMouseButton(event.button.button);
-            mHandler->mouseMotion(event.button.x, event.button.y);
-            break;
-        }
+    SDL_Event event;
+    std::vector<SDL_Event> events;
+    bool exposed = false;
 
-        if (mQuit) {
-            return;
+    bool more = wait ? SDL_WaitEvent(&event) : SDL_PollEvent(&event);
+
+    while (more) {
+        if (event.type == WAKE_EVENT) {
+            // only here to end SDL_WaitEvent()
+        } else if (event.type == SDL_VIDEOEXPOSE) {
+            exposed = true;
+        } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F1) {
+            SDL_WM_ToggleFullScreen(SDL_GetVideoSurface());
+            exposed = true;
+        } else if (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_r) {
+            HUD::getInstance().toggleRadar();
+        } else if (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_c) {
+            Model::getInstance().cycleCameraView();
+        } else {
+            events.push_back(event);
         }
+        more = SDL_PollEvent(&event);
+    }
+
+    if (!events.empty()) {
+        std::lock_guard<std::mutex> lock(mEventLock);
+        mEvents.insert(mEvents.end(), events.begin(), events.end());
+        mEventReady.notify_one();
+    }
+    return exposed;
+}
+
+void Controller::wake()
+{
+    SDL_Event event;
+    event.type = WAKE_EVENT;
+    SDL_PushEvent(&event);
+}
+
+void Controller::waitEvents(unsigned int ms)
+{
+    std::unique_lock<std::mutex> lock(mEventLock);
+    mEventReady.wait_for(lock, std::chrono::milliseconds(ms), [this] { return !mEvents.empty(); });
+}
+
+bool Controller::process(double dt)
+{
+    {
+        std::lock_guard<std::mutex> lock(mEventLock);
+        mPending.swap(mEvents);
     }
 
-    if (dt > 0) {
+    bool handled = !mPending.empty();
+
+    // nothing after a quit is dispatched
+    for (std::size_t i = 0; i < mPending.size() && !mQuit; i++) {
+        dispatch(mPending[i]);
+    }
+    mPending.clear();
+
+    if (!mQuit && dt > 0) {
         mHandler->process(dt);
     }
+    return handled;
+}
+
+void Controller::dispatch(const SDL_Event& event)
+{
+    switch (event.type) {
+    case SDL_QUIT:
+        mQuit = true;
+        break;
+    case SDL_KEYDOWN:
+        if (event.key.keysym.sym == SDLK_ESCAPE) {
+            mQuit = true;
+        } else {
+            mHandler->pressKey(event.key.keysym.sym);
+        }
+        break;
+    case SDL_KEYUP:
+        keyUp(event.key.keysym.sym);
+        break;
+
+    case SDL_MOUSEMOTION:
+        mHandler->mouseMotion(event.motion.x, event.motion.y);
+        break;
+
+    case SDL_MOUSEBUTTONDOWN:
+        mHandler->pressMouseButton(event.button.button);
+        mHandler->mouseMotion(event.button.x, event.button.y);
+        break;
+    case SDL_MOUSEBUTTONUP:
+        mHandler->releaseMouseButton(event.button.button);
+        mHandler->mouseMotion(event.button.x, event.button.y);
+        break;
+    }
 }
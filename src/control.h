@@ -13,6 +13,27 @@
 
 #include "handler.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: Controller
+//
+// Events are read by pump() on the thread that opened the window, which
+// is also the one drawing. The keys that only change how things are drawn
+// (full screen, radar, camera) take effect there; everything else is
+// queued and handed to the current EventHandler by process() on the
+// simulation's side.
+//
+// While the game is idle (paused or in the menu) neither side needs to
+// run until something happens: pump(true) sleeps in SDL_WaitEvent() and
+// the simulation in waitEvents(). wake() gets the first out of its sleep
+// when the simulation has something new to draw.
+//
+// --------------------------------------------------------------------------
+
 class Controller {
 public:
     Controller();
@@ -28,15 +49,28 @@ public:
     inline bool isPaused() { return mPause; }
     inline void unPause() { mPause = false; }
     inline bool slowMotion() { return mSlowMo; }
-    void poll(double dt);
+    // Returns whether the window has to be drawn again
+    bool pump(bool wait = false);
+
+    // Returns whether any events were handled
+    bool process(double dt);
+
+    void waitEvents(unsigned int ms);
+    static void wake();
+
     void setHandler(EventHandler* h) { mHandler = h; }
 
 private:
+    void dispatch(const SDL_Event& event);
     void keyUp(int sym);
 
     EventHandler* mHandler;
 
     bool mQuit, mPause, mSlowMo;
+
+    std::mutex mEventLock;
+    std::condition_variable mEventReady;
+    std::vector<SDL_Event> mEvents, mPending;
 };
 
 #endif // SSC_CONTROL_H
@@ -13,13 +13,13 @@
 
 bool Ship::collision(ScreenObject& obj)
 {
-    if (obj.ownerType() == PLAYER_TYPE) {
-        return false;
-    }
+    return obj.type() != LUNATIC_TYPE;
+}
 
+void Ship::collided(ScreenObject& obj, const CollisionEvent&)
+{
     switch (obj.type()) {
     case MISSILE_TYPE:
-        damage(.10);
         break;
     case BOGEY_TYPE:
     case SMARTY_TYPE:
@@ -27,7 +27,6 @@ bool Ship::collision(ScreenObject& obj)
         break;
     case LUNATIC_TYPE:
         damage(.005);
-        return false;
         break;
     case ASTEROID_TYPE:
     case FATSO_TYPE:
@@ -39,10 +38,20 @@ bool Ship::collision(ScreenObject& obj)
     case PLAYER_TYPE:
         break;
     }
+}
+
+bool Ship::shot(ObjectType)
+{
+    damage(.10);
     return true;
 }
 
-bool Bogey::collision(ScreenObject& obj)
+bool Bogey::collision(ScreenObject&)
+{
+    return true;
+}
+
+void Bogey::collided(ScreenObject& obj, const CollisionEvent&)
 {
     if (obj.mFlocking) {
         double d = distance(mPosition, obj.mPosition);
@@ -53,11 +62,6 @@ bool Bogey::collision(ScreenObject& obj)
 
     switch (obj.type()) {
     case MISSILE_TYPE:
-        if (obj.ownerType() != BOGEY_TYPE) {
-            damage(.10);
-        } else {
-            return false;
-        }
         break;
     case LUNATIC_TYPE:
         damage(.005);
@@ -75,5 +79,10 @@ bool Bogey::collision(ScreenObject& obj)
         damage(.01);
         break;
     }
+}
+
+bool Bogey::shot(ObjectType)
+{
+    damage(.10);
     return true;
 }
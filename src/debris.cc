@@ -0,0 +1,143 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "debris.h"
+#include "explode.h"
+#include "snapshot.h"
+
+DebrisPool::DebrisPool()
+    : mScale(1)
+    , mViewX0(0)
+    , mViewY0(0)
+    , mViewX1(Screen::maxX())
+    , mViewY1(Screen::maxY())
+    , mDrawn(0)
+{
+}
+
+void DebrisPool::setView(double x0, double y0, double x1, double y1)
+{
+    mViewX0 = x0 - TRIANGLE_RADIUS, mViewY0 = y0 - TRIANGLE_RADIUS;
+    mViewX1 = x1 + TRIANGLE_RADIUS, mViewY1 = y1 + TRIANGLE_RADIUS;
+}
+
+static float spread() { return (float)((rand() % 101) - 50) / 10.0f; }
+
+void DebrisPool::spawn(ScreenObject& obj, unsigned int count)
+{
+    count = (unsigned int)(count * mScale + .5f);
+
+    for (unsigned int i = 0; i < count; i++) {
+        int n = (rand() % obj.radius);
+        double d = RAD(rand() % 360);
+
+        mX.push_back(obj.mPosition.x + n * sin(d));
+        mY.push_back(obj.mPosition.y + n * cos(d));
+        mZ.push_back(obj.mPosition.z + n * (sin(d * d)));
+        mVX.push_back(obj.mVelocity.x + spread());
+        mVY.push_back(obj.mVelocity.y + spread());
+        mVZ.push_back(obj.mVelocity.z + spread());
+        mRX.push_back(RAD(rand() % 360));
+        mRY.push_back(RAD(rand() % 360));
+        mRZ.push_back(RAD(rand() % 360));
+        mSX.push_back(2 * RAD(rand() % 360));
+        mSY.push_back(2 * RAD(rand() % 360));
+        mSZ.push_back(2 * RAD(rand() % 360));
+        mR.push_back(obj.r);
+        mG.push_back(obj.g);
+        mB.push_back(obj.b);
+        mAge.push_back(0);
+    }
+}
+
+void DebrisPool::clear()
+{
+    mX.clear(), mY.clear(), mZ.clear();
+    mVX.clear(), mVY.clear(), mVZ.clear();
+    mRX.clear(), mRY.clear(), mRZ.clear();
+    mSX.clear(), mSY.clear(), mSZ.clear();
+    mR.clear(), mG.clear(), mB.clear();
+    mAge.clear();
+}
+
+// Order does not matter, so the last piece fills the hole
+
+void DebrisPool::remove(std::size_t n)
+{
+    std::size_t last = mX.size() - 1;
+
+    mX[n] = mX[last], mY[n] = mY[last], mZ[n] = mZ[last];
+    mVX[n] = mVX[last], mVY[n] = mVY[last], mVZ[n] = mVZ[last];
+    mRX[n] = mRX[last], mRY[n] = mRY[last], mRZ[n] = mRZ[last];
+    mSX[n] = mSX[last], mSY[n] = mSY[last], mSZ[n] = mSZ[last];
+    mR[n] = mR[last], mG[n] = mG[last], mB[n] = mB[last];
+    mAge[n] = mAge[last];
+
+    mX.pop_back(), mY.pop_back(), mZ.pop_back();
+    mVX.pop_back(), mVY.pop_back(), mVZ.pop_back();
+    mRX.pop_back(), mRY.pop_back(), mRZ.pop_back();
+    mSX.pop_back(), mSY.pop_back(), mSZ.pop_back();
+    mR.pop_back(), mG.pop_back(), mB.pop_back();
+    mAge.pop_back();
+}
+
+void DebrisPool::update(double dt)
+{
+    std::size_t count = mX.size();
+
+    if (count == 0)
+        return;
+
+    // straight line integration over plain arrays; the compiler
+    // vectorizes this loop
+
+    float step = dt;
+    float *x = &mX[0], *y = &mY[0], *z = &mZ[0],
+          *vx = &mVX[0], *vy = &mVY[0], *vz = &mVZ[0],
+          *rx = &mRX[0], *ry = &mRY[0], *rz = &mRZ[0],
+          *sx = &mSX[0], *sy = &mSY[0], *sz = &mSZ[0],
+          *age = &mAge[0];
+
+    for (std::size_t n = 0; n < count; n++) {
+        x[n] += vx[n] * step;
+        y[n] += vy[n] * step;
+        z[n] += vz[n] * step;
+        rx[n] += sx[n] * step;
+        ry[n] += sy[n] * step;
+        rz[n] += sz[n] * step;
+        age[n] += step;
+    }
+
+    // Walk backwards so removing a piece never skips one
+
+    for (std::size_t n = count; n-- > 0;) {
+        if (mAge[n] > LIFE_TIME)
+            remove(n);
+    }
+}
+
+void DebrisPool::record(Snapshot& snap)
+{
+    mDrawn = 0;
+
+    for (std::size_t n = 0; n < mX.size(); n++) {
+        if (mX[n] < mViewX0 || mX[n] > mViewX1 || mY[n] < mViewY0 || mY[n] > mViewY1)
+            continue;
+        mDrawn++;
+
+        Snapshot::Debris d;
+        d.x = mX[n], d.y = mY[n], d.z = mZ[n];
+        d.rx = mRX[n], d.ry = mRY[n], d.rz = mRZ[n];
+        d.radius = TRIANGLE_RADIUS;
+        d.r = mR[n], d.g = mG[n], d.b = mB[n];
+        d.a = 1.0f - mAge[n] / LIFE_TIME;
+        snap.debris.push_back(d);
+    }
+}
@@ -0,0 +1,72 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_DEBRIS_H
+#define SSC_DEBRIS_H
+
+#include <cstddef>
+#include <vector>
+
+class ScreenObject;
+struct Snapshot;
+
+// --------------------------------------------------------------------------
+//
+// CLASS: DebrisPool
+//
+// The tumbling triangles of every explosion in play. Objects no longer
+// carry their debris around while alive; an explosion spawns its pieces
+// here when it happens, and they are kept in flat arrays, one per field,
+// moved and aged in a single loop over all of them and dropped when they
+// have faded out. Each piece takes its colour from the object that blew
+// up.
+//
+// --------------------------------------------------------------------------
+
+class DebrisPool {
+public:
+    static DebrisPool& getInstance()
+    {
+        static DebrisPool instance;
+        return instance;
+    }
+
+    // count pieces scattered over obj, moving with it, times the scale
+    void spawn(ScreenObject& obj, unsigned int count);
+    void setScale(float scale) { mScale = scale; }
+
+    void update(double dt);
+    void clear();
+
+    // Only pieces inside the rectangle set by setView() are recorded
+    void setView(double x0, double y0, double x1, double y1);
+    void record(Snapshot& snap);
+
+    std::size_t size() { return mX.size(); }
+    std::size_t drawn() { return mDrawn; }
+
+private:
+    DebrisPool();
+
+    void remove(std::size_t n);
+
+    std::vector<float> mX, mY, mZ;
+    std::vector<float> mVX, mVY, mVZ;
+    std::vector<float> mRX, mRY, mRZ; // rotation, degrees about each axis
+    std::vector<float> mSX, mSY, mSZ; // rotation speed
+    std::vector<float> mR, mG, mB;
+    std::vector<float> mAge;
+
+    float mScale;
+    float mViewX0, mViewY0, mViewX1, mViewY1;
+    std::size_t mDrawn;
+};
+
+#endif // SSC_DEBRIS_H
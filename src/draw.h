@@ -28,6 +28,8 @@
 #include "common.h"
 #include "screen.h"
 
+#include <algorithm>
+
 namespace draw {
 enum DrawMode { DRAW_2D,
                 DRAW_3D };
@@ -102,6 +104,7 @@ inline void setMode(DrawMode newMode)
 }
 
 inline void flush() { glFlush(); }
+inline void finish() { glFinish(); }
 inline void flipBuffers() { SDL_GL_SwapBuffers(); }
 inline void clearScreen() { glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); }
 inline void setColor(float r, float g, float b) { glColor4f(r, g, b, 1.0); }
@@ -123,13 +126,17 @@ inline void checkErrors()
     }
 }
 
-inline void sphere(Coord3<double>& pos, double r, int add = 3, int b = 10)
+// detail scales the slices and stacks down from the usual
+inline void sphere(Coord3<double>& pos, double r, int add = 3, int b = 10, double detail = 1)
 {
+    int slices = std::max(5, (int)(((int)r + add) * detail)),
+        stacks = std::max(4, (int)(b * detail));
+
     glPushMatrix();
     glTranslated(pos.x, -pos.y, pos.z);
     gluQuadricDrawStyle(mSphere, GLU_FILL);
     gluQuadricNormals(mSphere, GLU_SMOOTH);
-    gluSphere(mSphere, r, (int)r + add, b);
+    gluSphere(mSphere, r, slices, stacks);
     glPopMatrix();
 }
 
@@ -193,6 +200,22 @@ inline void box(int x1, int y1, int x2, int y2)
     glEnd();
 }
 
+// The bound texture over a box, (x1, y1) taking texel (0, 0) and (x2, y2)
+// taking (u, v)
+inline void texturedBox(int x1, int y1, int x2, int y2, float u, float v)
+{
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 0);
+    glVertex2i(x1, Screen::mDisplay.y - y1);
+    glTexCoord2f(0, v);
+    glVertex2i(x1, Screen::mDisplay.y - y2);
+    glTexCoord2f(u, v);
+    glVertex2i(x2, Screen::mDisplay.y - y2);
+    glTexCoord2f(u, 0);
+    glVertex2i(x2, Screen::mDisplay.y - y1);
+    glEnd();
+}
+
 inline void startPoints() { glBegin(GL_POINTS); }
 
 inline void point(int x, int y, int z = 0)
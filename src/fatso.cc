@@ -11,6 +11,7 @@
 #include "fatso.h"
 #include "draw.h"
 #include "graph.h"
+#include "snapshot.h"
 
 int FATSO = -1;
 
@@ -23,26 +24,33 @@ Fatso::Fatso()
 {
     r = .8, g = .7, b = .6;
     setState(ALIVE);
+}
+
+Fatso::~Fatso()
+{
+}
 
+static void render(const Snapshot::Item& item)
+{
     if (FATSO == -1) {
         FATSO = glGenLists(1);
         glNewList(FATSO, GL_COMPILE);
         GLUquadricObj* m = gluNewQuadric();
-        gluSphere(m, radius, radius + 3, 10);
+        gluSphere(m, FATSO_RADIUS, FATSO_RADIUS + 3, 10);
         gluDeleteQuadric(m);
         glEndList();
     }
-}
 
-Fatso::~Fatso()
-{
-}
-
-void Fatso::draw()
-{
     glPushMatrix();
-    glTranslated(mPosition.x, -mPosition.y, mPosition.z);
-    draw::setColor(r, g, b, 1.0);
+    glTranslated(item.x, -item.y, item.z);
+    draw::setColor(item.r, item.g, item.b, item.a);
     glCallList(FATSO);
     glPopMatrix();
 }
+
+void Fatso::record(Snapshot& snap)
+{
+    Snapshot::Item& item = snap.addItem(render);
+    item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
+    item.r = r, item.g = g, item.b = b;
+}
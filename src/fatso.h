@@ -25,7 +25,7 @@ public:
     Fatso();
     ~Fatso();
 
-    void draw();
+    void record(Snapshot& snap);
     void move(double dt) { ScreenObject::move(dt); }
     bool collision(ScreenObject&) { return true; }
 };
@@ -118,6 +118,8 @@ void Face::init(void)
 
     compile_mode_ = COMPILE;
 
+    glyph_dlists_ = &own_dlists_;
+
     // By default, all drawing is wrapped with push/pop matrix so that the
     // MODELVIEW matrix is not modified. If advance_ is set, then subsequent
     // drawings follow from the advance of the last glyph rendered.
@@ -435,9 +437,9 @@ GLuint Face::compile(unsigned char c)
 {
     // See if we've done it already
 
-    GDLCI fgi = glyph_dlists_.find(c);
+    GDLCI fgi = glyph_dlists_->find(c);
 
-    if (fgi != glyph_dlists_.end())
+    if (fgi != glyph_dlists_->end())
         return fgi->second;
 
     unsigned int f;
@@ -454,7 +456,7 @@ GLuint Face::compile(unsigned char c)
 
     GLuint dlist = compileGlyph(faces_[f].face_, glyph_index);
 
-    glyph_dlists_[c] = dlist;
+    (*glyph_dlists_)[c] = dlist;
 
     return dlist;
 }
@@ -488,9 +490,9 @@ void Face::draw(unsigned char c)
 {
     // See if we've done it already
 
-    GDLCI fgi = glyph_dlists_.find(c);
+    GDLCI fgi = glyph_dlists_->find(c);
 
-    if (fgi != glyph_dlists_.end()) {
+    if (fgi != glyph_dlists_->end()) {
         glCallList(fgi->second);
         return;
     }
@@ -624,7 +626,8 @@ void Raster::init(void)
 
 Raster::~Raster(void)
 {
-    clearCaches();
+    GlyphCache::instance().forget(this);
+    glyph_dlists_ = &own_dlists_;
 }
 
 void Raster::setCharacterRotationZ(GLfloat character_rotation_z)
@@ -756,15 +759,140 @@ void Raster::setRotationOffset(void)
     rotation_offset_y_ = rotation_reference_face_->glyph->bitmap.rows / 2.;
 }
 
+// Called whenever something that affects the rendered glyphs changes.
+// Rather than deleting the display lists, switch to the glyph set for the
+// new state; the old one stays resident until the cache needs the room.
+
 void Raster::clearCaches(void)
 {
-    GDLI fgi = glyph_dlists_.begin();
+    GlyphCache::Key key;
+    key.face_ = this;
+    key.point_size_ = point_size_;
+    key.resolution_ = resolution_;
+    key.color_mode_ = colorMode();
+    key.character_rotation_z_ = character_rotation_z_;
+    key.string_rotation_ = string_rotation_;
+    key.rotation_offset_y_ = rotation_offset_y_;
+
+    glyph_dlists_ = &GlyphCache::instance().select(key);
+}
+
+unsigned int Raster::colorMode(void) const
+{
+    unsigned int mode = 2166136261u;
+
+    for (int i = 0; i < 4; i++) {
+        mode = (mode ^ (unsigned int)(foreground_color_[i] * 255)) * 16777619u;
+        mode = (mode ^ (unsigned int)(background_color_[i] * 255)) * 16777619u;
+    }
+
+    return mode;
+}
+
+// Total display lists across all sets before old sets are released.
+
+static const std::size_t GLYPH_CACHE_BUDGET = 1024;
+
+GlyphCache::GlyphCache(void)
+    : budget_(GLYPH_CACHE_BUDGET)
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0)
+{
+}
+
+GlyphCache& GlyphCache::instance(void)
+{
+    static GlyphCache cache;
+    return cache;
+}
+
+GlyphCache::Glyphs& GlyphCache::select(const Key& key)
+{
+    Sets::iterator s = sets_.end();
+
+    for (Sets::iterator i = sets_.begin(); i != sets_.end(); ++i) {
+        if (i->first.face_ != key.face_)
+            continue;
+        if (i->first == key)
+            s = i;
+        else
+            i->second.current_ = false;
+    }
+
+    if (s != sets_.end()) {
+        hits_++;
+        if (s != sets_.begin())
+            sets_.splice(sets_.begin(), sets_, s);
+    } else {
+        misses_++;
+        sets_.push_front(std::make_pair(key, Set()));
+    }
+
+    sets_.front().second.current_ = true;
+
+    trim();
+
+    return sets_.front().second.glyphs_;
+}
+
+std::size_t GlyphCache::displayLists(void) const
+{
+    std::size_t n = 0;
+
+    for (Sets::const_iterator s = sets_.begin(); s != sets_.end(); ++s)
+        n += s->second.glyphs_.size();
+
+    return n;
+}
+
+void GlyphCache::release(Sets::iterator set)
+{
+    Glyphs::iterator g = set->second.glyphs_.begin();
+
+    for (; g != set->second.glyphs_.end(); ++g)
+        glDeleteLists(g->second, 1);
+
+    sets_.erase(set);
+}
+
+// Release the least recently used sets until the cache fits its budget.
+// Sets in use by a face are skipped, whatever their size.
 
-    for (; fgi != glyph_dlists_.end(); ++fgi) {
-        glDeleteLists(fgi->second, 1);
+void GlyphCache::trim(void)
+{
+    std::size_t n = displayLists();
+
+    Sets::iterator s = sets_.end();
+    while (n > budget_ && s != sets_.begin()) {
+        --s;
+        if (s->second.current_)
+            continue;
+
+        Sets::iterator victim = s++;
+        n -= victim->second.glyphs_.size();
+        release(victim);
+        evictions_++;
     }
+}
 
-    glyph_dlists_.clear();
+void GlyphCache::forget(const Face* face)
+{
+    Sets::iterator s = sets_.begin();
+
+    while (s != sets_.end()) {
+        Sets::iterator next = s;
+        ++next;
+        if (s->first.face_ == face)
+            release(s);
+        s = next;
+    }
+}
+
+void GlyphCache::setBudget(std::size_t display_lists)
+{
+    budget_ = display_lists;
+    trim();
 }
 
 Monochrome::Monochrome(const char* filename, float point_size,
@@ -899,4 +1027,863 @@ void Monochrome::renderGlyph(FT_Face face, FT_UInt glyph_index)
 
     delete[] inverted_bitmap;
 }
+
+// Number of string layouts kept before the least recently used is dropped.
+
+static const std::size_t LAYOUT_CACHE_CAPACITY = 256;
+
+TextLayoutCache::TextLayoutCache(void)
+    : capacity_(LAYOUT_CACHE_CAPACITY)
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0)
+{
+}
+
+TextLayoutCache& TextLayoutCache::instance(void)
+{
+    static TextLayoutCache cache;
+    return cache;
+}
+
+std::size_t TextLayoutCache::KeyHash::operator()(const Key& k) const
+{
+    std::size_t h = std::hash<std::string>()(k.text_);
+    h ^= std::hash<const void*>()(k.face_) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<float>()(k.point_size_) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= k.resolution_ + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+TextLayoutCache::Layout& TextLayoutCache::lookup(const Face* face,
+                                                 float point_size,
+                                                 FT_UInt resolution,
+                                                 const char* s,
+                                                 unsigned int generation,
+                                                 bool& hit)
+{
+    Key key;
+    key.face_ = face;
+    key.point_size_ = point_size;
+    key.resolution_ = resolution;
+    key.text_ = s;
+
+    Index::iterator i = index_.find(key);
+
+    if (i != index_.end()) {
+        Entries::iterator e = i->second;
+
+        // move to the front of the recently used list
+        if (e != entries_.begin())
+            entries_.splice(entries_.begin(), entries_, e);
+
+        hit = e->second.generation_ == generation;
+        if (hit)
+            hits_++;
+        else
+            misses_++;
+
+        return e->second;
+    }
+
+    misses_++;
+    hit = false;
+
+    entries_.push_front(std::make_pair(key, Layout()));
+    index_[key] = entries_.begin();
+
+    while (entries_.size() > capacity_)
+        evict();
+
+    return entries_.front().second;
+}
+
+void TextLayoutCache::evict(void)
+{
+    Entries::iterator last = --entries_.end();
+    index_.erase(last->first);
+    entries_.erase(last);
+    evictions_++;
+}
+
+void TextLayoutCache::forget(const Face* face)
+{
+    Entries::iterator e = entries_.begin();
+
+    while (e != entries_.end()) {
+        if (e->first.face_ == face) {
+            index_.erase(e->first);
+            e = entries_.erase(e);
+        } else
+            ++e;
+    }
+}
+
+void TextLayoutCache::setCapacity(std::size_t capacity)
+{
+    capacity_ = capacity > 0 ? capacity : 1;
+
+    while (entries_.size() > capacity_)
+        evict();
+}
+
+// The atlas is one square GL_ALPHA texture shared by every size.
+
+static const GLsizei ATLAS_SIZE = 512;
+
+Atlas::Atlas(const char* filename, float point_size, FT_UInt resolution)
+    : Raster(filename, point_size, resolution)
+{
+    init();
+}
+
+Atlas::Atlas(FT_Face face, float point_size, FT_UInt resolution)
+    : Raster(face, point_size, resolution)
+{
+    init();
+}
+
+void Atlas::init(void)
+{
+    texture_ = 0;
+    texture_size_ = ATLAS_SIZE;
+    shelf_x_ = shelf_y_ = shelf_height_ = 0;
+    generation_ = 0;
+    current_ = 0;
+    batching_ = false;
+}
+
+Atlas::~Atlas(void)
+{
+    TextLayoutCache::instance().forget(this);
+
+    for (unsigned int i = 0; i < pages_.size(); i++)
+        delete pages_[i];
+
+    if (texture_ != 0)
+        glDeleteTextures(1, &texture_);
+}
+
+// Point size, resolution and colour changes all land here. The atlas keeps
+// every page it has built, so all that is needed is to look the current
+// page up again on the next draw.
+
+void Atlas::clearCaches(void)
+{
+    current_ = 0;
+}
+
+Atlas::Page* Atlas::page(void)
+{
+    if (current_ != 0)
+        return current_;
+
+    for (unsigned int i = 0; i < pages_.size(); i++) {
+        if (pages_[i]->point_size_ == point_size_ && pages_[i]->resolution_ == resolution_) {
+            current_ = pages_[i];
+            return current_;
+        }
+    }
+
+    Page* page = new Page;
+    page->point_size_ = point_size_;
+    page->resolution_ = resolution_;
+    for (int c = 0; c < 256; c++)
+        page->glyphs_[c].loaded_ = false;
+
+    pages_.push_back(page);
+    current_ = page;
+
+    // Rasterize the printable ASCII range up front; the rest of latin1
+    // is added the first time it is used.
+
+    for (int c = ' '; c <= '~'; c++)
+        glyph(*page, c);
+
+    return current_;
+}
+
+const Atlas::Glyph& Atlas::glyph(Page& page, unsigned char c)
+{
+    Glyph& g = page.glyphs_[c];
+
+    if (!g.loaded_) {
+        if (!rasterize(page, c)) {
+            // Out of room: start the atlas over and try once more.
+            flush();
+            reset();
+            rasterize(page, c);
+        }
+    }
+
+    return g;
+}
+
+// Forget where every glyph was placed so the texture can be refilled.
+
+void Atlas::reset(void)
+{
+    for (unsigned int i = 0; i < pages_.size(); i++) {
+        for (int c = 0; c < 256; c++)
+            pages_[i]->glyphs_[c].loaded_ = false;
+    }
+
+    shelf_x_ = shelf_y_ = shelf_height_ = 0;
+
+    // layouts built against the old placement are now stale
+    generation_++;
+}
+
+bool Atlas::rasterize(Page& page, unsigned char c)
+{
+    Glyph& g = page.glyphs_[c];
+
+    g.loaded_ = true;
+    g.index_ = 0;
+    g.u0_ = g.v0_ = g.u1_ = g.v1_ = 0;
+    g.x0_ = g.y0_ = g.x1_ = g.y1_ = 0;
+    g.pad_ = 0;
+    g.advance_ = 0;
+
+    unsigned int f;
+    FT_UInt glyph_index = 0;
+
+    for (f = 0; f < faces_.size(); f++) {
+        glyph_index = FT_Get_Char_Index(faces_[f].face_, c);
+        if (glyph_index != 0)
+            break;
+    }
+
+    if (glyph_index == 0)
+        return true;
+
+    FT_Face face = faces_[f].face_;
+
+    if (FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER) != 0)
+        return true;
+
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+
+    g.index_ = glyph_index;
+    g.advance_ = slot->advance.x / 64.;
+
+    int width = bitmap.width, rows = bitmap.rows;
+
+    if (width == 0 || rows == 0)
+        return true;
+
+    // Shelf packing with a one texel gap between glyphs
+
+    if (shelf_x_ + width + 1 > texture_size_) {
+        shelf_x_ = 0;
+        shelf_y_ += shelf_height_ + 1;
+        shelf_height_ = 0;
+    }
+
+    if (shelf_y_ + rows + 1 > texture_size_) {
+        g.loaded_ = false;
+        return false;
+    }
+
+    GLint x = shelf_x_, y = shelf_y_;
+    shelf_x_ += width + 1;
+    if (rows > shelf_height_)
+        shelf_height_ = rows;
+
+    // Expand to one byte of coverage per texel, top row first
+
+    std::vector<GLubyte> texels(width * rows);
+
+    for (int r = 0; r < rows; r++) {
+        const unsigned char* src = bitmap.pitch >= 0
+            ? bitmap.buffer + r * bitmap.pitch
+            : bitmap.buffer + (rows - 1 - r) * -bitmap.pitch;
+        GLubyte* dst = &texels[r * width];
+
+        if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO) {
+            for (int p = 0; p < width; p++)
+                dst[p] = (src[p >> 3] & (0x80 >> (p & 7))) ? 255 : 0;
+        } else {
+            for (int p = 0; p < width; p++)
+                dst[p] = src[p];
+        }
+    }
+
+    if (texture_ == 0) {
+        std::vector<GLubyte> blank(texture_size_ * texture_size_, 0);
+
+        glGenTextures(1, &texture_);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texture_size_, texture_size_,
+                     0, GL_ALPHA, GL_UNSIGNED_BYTE, &blank[0]);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, rows,
+                    GL_ALPHA, GL_UNSIGNED_BYTE, &texels[0]);
+
+    GLfloat size = texture_size_;
+
+    g.u0_ = x / size;
+    g.v0_ = y / size;
+    g.u1_ = (x + width) / size;
+    g.v1_ = (y + rows) / size;
+
+    g.x0_ = slot->bitmap_left;
+    g.x1_ = slot->bitmap_left + width;
+    g.y1_ = slot->bitmap_top;
+    g.y0_ = slot->bitmap_top - rows;
+
+    return true;
+}
+
+BBox Atlas::measure(unsigned char c)
+{
+    const Glyph& g = glyph(*page(), c);
+
+    BBox bbox;
+    if (g.x1_ > g.x0_) {
+        bbox.x_min_ = g.x0_ + g.pad_;
+        bbox.y_min_ = g.y0_ + g.pad_;
+        bbox.x_max_ = g.x1_ - g.pad_;
+        bbox.y_max_ = g.y1_ - g.pad_;
+    }
+    bbox.advance_.dx_ = g.advance_;
+    bbox *= scale();
+
+    return bbox;
+}
+
+// Lay the string out once at the origin. Rasterizing a missing glyph can
+// repack the atlas, in which case the quads placed so far are stale and
+// the layout is built again.
+
+const TextLayoutCache::Layout& Atlas::layout(const char* s)
+{
+    Page& p = *page();
+
+    // keyed on the face's size rather than the page's: a distance field
+    // draws every size from one page, scaling the quads to fit
+    bool hit;
+    TextLayoutCache::Layout& l = TextLayoutCache::instance().lookup(
+        this, point_size_, resolution_, s, generation_, hit);
+
+    if (hit)
+        return l;
+
+    const GLfloat k = scale();
+
+    do {
+        l.generation_ = generation_;
+        l.quads_.clear();
+        l.bbox_ = BBox();
+
+        GLfloat pen_x = 0;
+        bool first = true;
+
+        for (const unsigned char* c = (const unsigned char*)s; *c != 0; c++) {
+            const Glyph& g = glyph(p, *c);
+
+            BBox char_bbox;
+            if (g.x1_ > g.x0_) {
+                char_bbox.x_min_ = (g.x0_ + g.pad_) * k;
+                char_bbox.y_min_ = (g.y0_ + g.pad_) * k;
+                char_bbox.x_max_ = (g.x1_ - g.pad_) * k;
+                char_bbox.y_max_ = (g.y1_ - g.pad_) * k;
+            }
+            char_bbox.advance_.dx_ = g.advance_ * k;
+
+            if (first)
+                l.bbox_ = char_bbox, first = false;
+            else
+                l.bbox_ += char_bbox;
+
+            if (g.x1_ > g.x0_) {
+                TextLayoutCache::Quad q;
+                q.u0_ = g.u0_, q.v0_ = g.v0_, q.u1_ = g.u1_, q.v1_ = g.v1_;
+                q.x0_ = pen_x + g.x0_ * k, q.x1_ = pen_x + g.x1_ * k;
+                q.y0_ = g.y0_ * k, q.y1_ = g.y1_ * k;
+                l.quads_.push_back(q);
+            }
+
+            pen_x += g.advance_ * k;
+        }
+    } while (l.generation_ != generation_);
+
+    return l;
+}
+
+BBox Atlas::measure(const char* s)
+{
+    return layout(s).bbox_;
+}
+
+void Atlas::color(Vertex& v) const
+{
+    v.c_[0] = (GLubyte)(foreground_color_[R] * 255 + .5);
+    v.c_[1] = (GLubyte)(foreground_color_[G] * 255 + .5);
+    v.c_[2] = (GLubyte)(foreground_color_[B] * 255 + .5);
+    v.c_[3] = (GLubyte)(foreground_color_[A] * 255 + .5);
+    v.z_ = 0;
+}
+
+void Atlas::queue(GLfloat x, GLfloat y, const char* s)
+{
+    const TextLayoutCache::Layout& l = layout(s);
+
+    Vertex v;
+    color(v);
+
+    // glyphs are rasterized at whole pixels, so keep the origin on them too
+    GLfloat ox = floorf(x + .5), oy = floorf(y + .5);
+
+    std::vector<TextLayoutCache::Quad>::const_iterator q = l.quads_.begin();
+    for (; q != l.quads_.end(); ++q) {
+        GLfloat x0 = ox + q->x0_, x1 = ox + q->x1_,
+                y0 = oy + q->y0_, y1 = oy + q->y1_;
+
+        v.u_ = q->u0_, v.v_ = q->v1_, v.x_ = x0, v.y_ = y0;
+        vertices_.push_back(v);
+        v.u_ = q->u1_, v.v_ = q->v1_, v.x_ = x1, v.y_ = y0;
+        vertices_.push_back(v);
+        v.u_ = q->u1_, v.v_ = q->v0_, v.x_ = x1, v.y_ = y1;
+        vertices_.push_back(v);
+        v.u_ = q->u0_, v.v_ = q->v0_, v.x_ = x0, v.y_ = y1;
+        vertices_.push_back(v);
+    }
+}
+
+void Atlas::draw(GLfloat x, GLfloat y, const char* s)
+{
+    if (horizontal_justification_ != ORIGIN || vertical_justification_ != BASELINE) {
+        BBox bbox = measure(s);
+
+        switch (horizontal_justification_) {
+        case LEFT:
+            x -= bbox.x_min_;
+            break;
+        case CENTER:
+            x -= (bbox.x_min_ + bbox.x_max_) / 2.;
+            break;
+        case RIGHT:
+            x -= bbox.x_max_;
+            break;
+        default:
+            break;
+        }
+        switch (vertical_justification_) {
+        case BOTTOM:
+            y -= bbox.y_min_;
+            break;
+        case MIDDLE:
+            y -= (bbox.y_min_ + bbox.y_max_) / 2.;
+            break;
+        case TOP:
+            y -= bbox.y_max_;
+            break;
+        default:
+            break;
+        }
+    }
+
+    queue(x, y, s);
+
+    if (!batching_)
+        flush();
+}
+
+void Atlas::begin(void)
+{
+    batching_ = true;
+}
+
+void Atlas::end(void)
+{
+    batching_ = false;
+    flush();
+}
+
+void Atlas::flush(void)
+{
+    if (vertices_.empty())
+        return;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glInterleavedArrays(GL_T2F_C4UB_V3F, sizeof(Vertex), &vertices_[0]);
+    glDrawArrays(GL_QUADS, 0, vertices_.size());
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+
+    vertices_.clear();
+}
+
+// Used when a single glyph is drawn or compiled through Face::draw(c):
+// draw its quad at the origin and advance the MODELVIEW matrix.
+
+void Atlas::renderGlyph(FT_Face, FT_UInt glyph_index)
+{
+    Page& p = *page();
+
+    for (int c = 0; c < 256; c++) {
+        const Glyph& g = p.glyphs_[c];
+        if (!g.loaded_ || g.index_ != glyph_index)
+            continue;
+
+        if (g.x1_ > g.x0_) {
+            glEnable(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, texture_);
+            glBegin(GL_QUADS);
+            glTexCoord2f(g.u0_, g.v1_);
+            glVertex2f(g.x0_, g.y0_);
+            glTexCoord2f(g.u1_, g.v1_);
+            glVertex2f(g.x1_, g.y0_);
+            glTexCoord2f(g.u1_, g.v0_);
+            glVertex2f(g.x1_, g.y1_);
+            glTexCoord2f(g.u0_, g.v0_);
+            glVertex2f(g.x0_, g.y1_);
+            glEnd();
+            glDisable(GL_TEXTURE_2D);
+        }
+        glTranslatef(g.advance_, 0, 0);
+        return;
+    }
+}
+
+// The distance field is rendered once at a fixed pixel size. SPREAD is
+// how far from the outline, in those pixels, the field is still
+// resolved; it is also the margin left around every glyph so the field
+// can fall off to zero before the next one.
+
+static const int SDF_REFERENCE_PX = 32;
+static const int SDF_SPREAD = 4;
+static const GLsizei SDF_WIDTH = 512;
+static const GLfloat SDF_DEG2RAD = 3.14159265f / 180;
+
+DistanceField::DistanceField(const char* filename, float point_size, FT_UInt resolution)
+    : Atlas(filename, point_size, resolution)
+{
+    build();
+}
+
+DistanceField::DistanceField(FT_Face face, float point_size, FT_UInt resolution)
+    : Atlas(face, point_size, resolution)
+{
+    build();
+}
+
+DistanceField::~DistanceField(void)
+{
+}
+
+GLfloat DistanceField::scale(void) const
+{
+    return point_size_ * resolution_ / 72.f / SDF_REFERENCE_PX;
+}
+
+// The distance transform behind the field (8SSEDT). Each texel holds the
+// offset to the nearest seed texel found so far; two sweeps, one down and
+// one up the grid, hand every neighbour's offset on to the texel next to
+// it, so the cost is a fixed handful of compares per texel whatever the
+// spread.
+
+struct SdfOffset {
+    int dx_, dy_;
+};
+
+static const SdfOffset SDF_SEED = { 0, 0 };
+static const SdfOffset SDF_FAR = { 9999, 9999 };
+
+static inline int sdfLength(const SdfOffset& o)
+{
+    return o.dx_ * o.dx_ + o.dy_ * o.dy_;
+}
+
+static inline void sdfCompare(std::vector<SdfOffset>& grid, int w, int h,
+                              int x, int y, int ox, int oy)
+{
+    int nx = x + ox, ny = y + oy;
+    if (nx < 0 || nx >= w || ny < 0 || ny >= h)
+        return;
+
+    SdfOffset o = grid[ny * w + nx];
+    o.dx_ += ox;
+    o.dy_ += oy;
+    if (sdfLength(o) < sdfLength(grid[y * w + x]))
+        grid[y * w + x] = o;
+}
+
+static void sdfSweep(std::vector<SdfOffset>& grid, int w, int h)
+{
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            sdfCompare(grid, w, h, x, y, -1, 0);
+            sdfCompare(grid, w, h, x, y, 0, -1);
+            sdfCompare(grid, w, h, x, y, -1, -1);
+            sdfCompare(grid, w, h, x, y, 1, -1);
+        }
+        for (int x = w - 1; x >= 0; x--)
+            sdfCompare(grid, w, h, x, y, 1, 0);
+    }
+
+    for (int y = h - 1; y >= 0; y--) {
+        for (int x = w - 1; x >= 0; x--) {
+            sdfCompare(grid, w, h, x, y, 1, 0);
+            sdfCompare(grid, w, h, x, y, 0, 1);
+            sdfCompare(grid, w, h, x, y, -1, 1);
+            sdfCompare(grid, w, h, x, y, 1, 1);
+        }
+        for (int x = 0; x < w; x++)
+            sdfCompare(grid, w, h, x, y, -1, 0);
+    }
+}
+
+// Render every latin1 glyph at the reference size and turn its coverage
+// into a signed distance to the outline, 0.5 on the edge itself. All of
+// it is packed into one texture that is uploaded on the first flush.
+
+void DistanceField::build(void)
+{
+    struct Cell {
+        GLint x_, y_;
+        GLsizei w_, h_;
+    };
+    Cell cells[256];
+
+    width_ = SDF_WIDTH;
+    height_ = 0;
+    field_.point_size_ = SDF_REFERENCE_PX;
+    field_.resolution_ = 72;
+
+    for (unsigned int f = 0; f < faces_.size(); f++)
+        FT_Set_Pixel_Sizes(faces_[f].face_, 0, SDF_REFERENCE_PX);
+
+    GLint shelf_x = 0, shelf_y = 0, shelf_height = 0;
+    std::vector<bool> mask;
+    std::vector<SdfOffset> inner, outer;
+
+    for (int c = 0; c < 256; c++) {
+        Glyph& g = field_.glyphs_[c];
+        Cell& cell = cells[c];
+
+        g.loaded_ = true;
+        g.index_ = 0;
+        g.u0_ = g.v0_ = g.u1_ = g.v1_ = 0;
+        g.x0_ = g.y0_ = g.x1_ = g.y1_ = 0;
+        g.pad_ = SDF_SPREAD;
+        g.advance_ = 0;
+        cell.w_ = cell.h_ = 0;
+
+        unsigned int f;
+        FT_UInt glyph_index = 0;
+
+        for (f = 0; f < faces_.size(); f++) {
+            glyph_index = FT_Get_Char_Index(faces_[f].face_, c);
+            if (glyph_index != 0)
+                break;
+        }
+
+        if (glyph_index == 0)
+            continue;
+
+        if (FT_Load_Glyph(faces_[f].face_, glyph_index, FT_LOAD_RENDER) != 0)
+            continue;
+
+        FT_GlyphSlot slot = faces_[f].face_->glyph;
+        const FT_Bitmap& bitmap = slot->bitmap;
+        int width = bitmap.width, rows = bitmap.rows;
+
+        g.index_ = glyph_index;
+        g.advance_ = slot->advance.x / 64.;
+
+        if (width == 0 || rows == 0)
+            continue;
+
+        // Which texels of the bitmap are inside the outline, top row first
+
+        mask.assign(width * rows, false);
+
+        for (int r = 0; r < rows; r++) {
+            const unsigned char* src = bitmap.pitch >= 0
+                ? bitmap.buffer + r * bitmap.pitch
+                : bitmap.buffer + (rows - 1 - r) * -bitmap.pitch;
+
+            for (int p = 0; p < width; p++) {
+                if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+                    mask[r * width + p] = (src[p >> 3] & (0x80 >> (p & 7))) != 0;
+                else
+                    mask[r * width + p] = src[p] >= 128;
+            }
+        }
+
+        cell.w_ = width + 2 * SDF_SPREAD;
+        cell.h_ = rows + 2 * SDF_SPREAD;
+
+        // Shelf packing with a one texel gap between glyphs
+
+        if (shelf_x + cell.w_ + 1 > width_) {
+            shelf_x = 0;
+            shelf_y += shelf_height + 1;
+            shelf_height = 0;
+        }
+
+        cell.x_ = shelf_x, cell.y_ = shelf_y;
+        shelf_x += cell.w_ + 1;
+        if (cell.h_ > shelf_height)
+            shelf_height = cell.h_;
+
+        if (shelf_y + shelf_height > height_) {
+            height_ = shelf_y + shelf_height;
+            texels_.resize(width_ * height_, 0);
+        }
+
+        // Seed one offset grid from the inside texels and one from the
+        // outside ones; after the sweeps each texel holds its offset to
+        // the nearest texel on the other side in the grid of the side it
+        // is not on.
+
+        inner.resize(cell.w_ * cell.h_);
+        outer.resize(cell.w_ * cell.h_);
+
+        for (int y = 0; y < cell.h_; y++) {
+            for (int x = 0; x < cell.w_; x++) {
+                int mx = x - SDF_SPREAD, my = y - SDF_SPREAD;
+                bool inside = mx >= 0 && mx < width && my >= 0 && my < rows
+                    && mask[my * width + mx];
+                inner[y * cell.w_ + x] = inside ? SDF_SEED : SDF_FAR;
+                outer[y * cell.w_ + x] = inside ? SDF_FAR : SDF_SEED;
+            }
+        }
+
+        sdfSweep(inner, cell.w_, cell.h_);
+        sdfSweep(outer, cell.w_, cell.h_);
+
+        for (int y = 0; y < cell.h_; y++) {
+            for (int x = 0; x < cell.w_; x++) {
+                const SdfOffset& in = inner[y * cell.w_ + x];
+                bool inside = in.dx_ == 0 && in.dy_ == 0;
+                int nearest = sdfLength(inside ? outer[y * cell.w_ + x] : in);
+
+                // the outline runs halfway between the two texel centres
+                GLfloat distance = sqrtf(nearest) - .5f;
+                if (distance > SDF_SPREAD)
+                    distance = SDF_SPREAD;
+                if (!inside)
+                    distance = -distance;
+
+                texels_[(cell.y_ + y) * width_ + cell.x_ + x]
+                    = (GLubyte)(127.5f + 127.5f * distance / SDF_SPREAD);
+            }
+        }
+
+        g.x0_ = slot->bitmap_left - SDF_SPREAD;
+        g.x1_ = g.x0_ + cell.w_;
+        g.y1_ = slot->bitmap_top + SDF_SPREAD;
+        g.y0_ = g.y1_ - cell.h_;
+    }
+
+    // GL 1.x wants power of two textures
+
+    GLsizei height = 1;
+    while (height < height_)
+        height <<= 1;
+    height_ = height;
+    texels_.resize(width_ * height_, 0);
+
+    for (int c = 0; c < 256; c++) {
+        Glyph& g = field_.glyphs_[c];
+        const Cell& cell = cells[c];
+
+        if (cell.w_ == 0)
+            continue;
+
+        g.u0_ = cell.x_ / (GLfloat)width_;
+        g.v0_ = cell.y_ / (GLfloat)height_;
+        g.u1_ = (cell.x_ + cell.w_) / (GLfloat)width_;
+        g.v1_ = (cell.y_ + cell.h_) / (GLfloat)height_;
+    }
+
+    // Put the faces back at the size the rest of Face expects
+
+    for (unsigned int f = 0; f < faces_.size(); f++)
+        FT_Set_Char_Size(faces_[f].face_, (FT_F26Dot6)(point_size_ * 64),
+                         (FT_F26Dot6)(point_size_ * 64), resolution_, resolution_);
+}
+
+// Unlike the bitmap atlas, the quads here scale and rotate freely, so the
+// rotations are applied to the vertices rather than ignored.
+
+void DistanceField::queue(GLfloat x, GLfloat y, const char* s)
+{
+    const TextLayoutCache::Layout& l = layout(s);
+
+    Vertex v;
+    color(v);
+
+    GLfloat char_cos = cosf(character_rotation_z_ * SDF_DEG2RAD),
+            char_sin = sinf(character_rotation_z_ * SDF_DEG2RAD),
+            string_cos = cosf(string_rotation_ * SDF_DEG2RAD),
+            string_sin = sinf(string_rotation_ * SDF_DEG2RAD);
+
+    std::vector<TextLayoutCache::Quad>::const_iterator q = l.quads_.begin();
+    for (; q != l.quads_.end(); ++q) {
+        GLfloat cx = (q->x0_ + q->x1_) / 2, cy = (q->y0_ + q->y1_) / 2,
+                hx = (q->x1_ - q->x0_) / 2, hy = (q->y1_ - q->y0_) / 2;
+
+        const GLfloat corners[4][4] = {
+            { -hx, -hy, q->u0_, q->v1_ },
+            { hx, -hy, q->u1_, q->v1_ },
+            { hx, hy, q->u1_, q->v0_ },
+            { -hx, hy, q->u0_, q->v0_ },
+        };
+
+        for (int i = 0; i < 4; i++) {
+            GLfloat px = cx + corners[i][0] * char_cos - corners[i][1] * char_sin,
+                    py = cy + corners[i][0] * char_sin + corners[i][1] * char_cos;
+
+            v.x_ = x + px * string_cos - py * string_sin;
+            v.y_ = y + px * string_sin + py * string_cos;
+            v.u_ = corners[i][2], v.v_ = corners[i][3];
+            vertices_.push_back(v);
+        }
+    }
+}
+
+void DistanceField::flush(void)
+{
+    if (texture_ == 0 && !texels_.empty()) {
+        glGenTextures(1, &texture_);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width_, height_,
+                     0, GL_ALPHA, GL_UNSIGNED_BYTE, &texels_[0]);
+
+        // the texture holds the only copy from here on
+        std::vector<GLubyte>().swap(texels_);
+    }
+
+    // Linear filtering interpolates the distance, so cutting at the
+    // midpoint gives a sharp edge at any scale.
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, .5);
+    Atlas::flush();
+    glPopAttrib();
+}
 } // close OGLFT namespace
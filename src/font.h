@@ -22,7 +22,10 @@
 #ifndef OGLFT_H
 #define OGLFT_H
 
+#include <list>
 #include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #ifdef __APPLE__
@@ -336,8 +339,12 @@ protected:
     //! list map.
     typedef GlyphDLists::iterator GDLI;
 
-    //! Cache of defined glyph display lists
-    GlyphDLists glyph_dlists_;
+    //! Cache of defined glyph display lists. Styles may point this at a
+    //! shared cache; by default it is the face's own map.
+    GlyphDLists* glyph_dlists_;
+
+    //! The face's own glyph display lists.
+    GlyphDLists own_dlists_;
 
     //! The user can supply an array of display list which are invoked
     //! before each glyph is rendered.
@@ -709,7 +716,7 @@ public:
      * \param y the Y position.
      * \param s the (latin1) string to draw.
      */
-    void draw(GLfloat x, GLfloat y, const char* s);
+    virtual void draw(GLfloat x, GLfloat y, const char* s);
     /*!
      * \return the nominal ascender from the face. This is in "notional"
      * units.
@@ -755,6 +762,90 @@ private:
     BBox measure_nominal(const char* s);
 };
 
+//! Glyph display lists shared across rendering states.
+/*!
+   * Raster styles used to delete every glyph display list whenever the
+   * point size, resolution, colour or rotation changed, so alternating
+   * between two sizes re-rasterized every glyph on each switch. The
+   * GlyphCache instead keeps a separate set of display lists for every
+   * (face, point size, resolution, colour mode, rotation) a face has used,
+   * and a state change merely selects another set.
+   *
+   * The total number of display lists is held to budget(). When a switch
+   * leaves the cache over budget, whole sets are released, least recently
+   * used first. A set that is some face's current set is never released.
+   */
+class GlyphCache {
+public:
+    //! The rendering state a set of glyphs was rendered for.
+    struct Key {
+        const Face* face_;
+        float point_size_;
+        FT_UInt resolution_;
+        unsigned int color_mode_;
+        GLfloat character_rotation_z_;
+        GLfloat string_rotation_;
+        GLfloat rotation_offset_y_;
+
+        bool operator==(const Key& k) const
+        {
+            return face_ == k.face_ && point_size_ == k.point_size_
+                && resolution_ == k.resolution_ && color_mode_ == k.color_mode_
+                && character_rotation_z_ == k.character_rotation_z_
+                && string_rotation_ == k.string_rotation_
+                && rotation_offset_y_ == k.rotation_offset_y_;
+        }
+    };
+
+    typedef std::map<FT_UInt, GLuint> Glyphs;
+
+    /*!
+     * \return the global glyph cache.
+     */
+    static GlyphCache& instance(void);
+
+    /*!
+     * Make the glyph set for key the most recently used, creating it if
+     * needed, and release old sets if the cache is over budget.
+     * \return the set, which the face fills as glyphs are compiled.
+     */
+    Glyphs& select(const Key& key);
+
+    /*!
+     * Release every set belonging to face.
+     */
+    void forget(const Face* face);
+
+    void setBudget(std::size_t display_lists);
+    std::size_t budget(void) const { return budget_; }
+
+    //! Number of resident sets and display lists.
+    std::size_t sets(void) const { return sets_.size(); }
+    std::size_t displayLists(void) const;
+
+    //! Selection statistics since the last resetStats().
+    unsigned long hits(void) const { return hits_; }
+    unsigned long misses(void) const { return misses_; }
+    unsigned long evictions(void) const { return evictions_; }
+    void resetStats(void) { hits_ = misses_ = evictions_ = 0; }
+
+private:
+    struct Set {
+        Glyphs glyphs_;
+        bool current_; //!< Selected by its face right now.
+    };
+
+    typedef std::list<std::pair<Key, Set>> Sets;
+
+    GlyphCache(void);
+    void release(Sets::iterator set);
+    void trim(void);
+
+    Sets sets_; //!< Most recently used first.
+    std::size_t budget_;
+    unsigned long hits_, misses_, evictions_;
+};
+
 class Raster : public Face {
 protected:
     //! Raster glyph can be rotated in the Z plane (in addition to the string
@@ -811,6 +902,15 @@ public:
      */
     BBox measure(const char* s) { return Face::measure(s); }
 
+protected:
+    /*!
+     * Identifies how colour is baked into the glyphs of this style, so
+     * that glyph sets are only kept apart when the colour matters. The
+     * default distinguishes every foreground/background combination.
+     * \return a key for the current colours.
+     */
+    virtual unsigned int colorMode(void) const;
+
 private:
     void init(void);
     GLuint compileGlyph(FT_Face face, FT_UInt glyph_index);
@@ -863,10 +963,282 @@ public:
      */
     ~Monochrome(void);
 
+protected:
+    /*!
+     * Monochrome glyphs take their colour from the raster position at
+     * draw time, so every colour shares one glyph set.
+     */
+    unsigned int colorMode(void) const { return 0; }
+
 private:
     GLubyte* invertBitmap(const FT_Bitmap& bitmap);
     void renderGlyph(FT_Face face, FT_UInt glyph_index);
 };
 
+//! Cache of laid-out strings.
+/*!
+   * A layout is the list of glyph quads of a string, positioned relative to
+   * the string origin, together with its bounding box. Layouts are keyed by
+   * (face, point size, resolution, string) and kept in least recently used
+   * order; once the cache holds capacity() layouts the oldest is dropped.
+   * Each layout also records the atlas generation it was built against, so
+   * a face that repacks its texture makes its old layouts miss.
+   *
+   * One cache is shared by all faces.
+   */
+class TextLayoutCache {
+public:
+    //! A glyph quad, in pixels from the string origin.
+    struct Quad {
+        GLfloat u0_, v0_, u1_, v1_;
+        GLfloat x0_, y0_, x1_, y1_;
+    };
+
+    //! The cached layout of one string.
+    struct Layout {
+        std::vector<Quad> quads_;
+        BBox bbox_;
+        unsigned int generation_;
+    };
+
+    /*!
+     * \return the global layout cache.
+     */
+    static TextLayoutCache& instance(void);
+
+    /*!
+     * Look up a layout, inserting an empty one on a miss.
+     * \param hit set to true if the returned layout is valid.
+     * \return the layout, which the caller must fill if hit is false.
+     */
+    Layout& lookup(const Face* face, float point_size, FT_UInt resolution,
+                   const char* s, unsigned int generation, bool& hit);
+
+    /*!
+     * Drop every layout built by face.
+     */
+    void forget(const Face* face);
+
+    void setCapacity(std::size_t capacity);
+    std::size_t capacity(void) const { return capacity_; }
+    std::size_t size(void) const { return entries_.size(); }
+
+    //! Lookup statistics since the last resetStats().
+    unsigned long hits(void) const { return hits_; }
+    unsigned long misses(void) const { return misses_; }
+    unsigned long evictions(void) const { return evictions_; }
+    double hitRate(void) const
+    {
+        return hits_ + misses_ ? (double)hits_ / (hits_ + misses_) : 0;
+    }
+    void resetStats(void) { hits_ = misses_ = evictions_ = 0; }
+
+private:
+    struct Key {
+        const Face* face_;
+        float point_size_;
+        FT_UInt resolution_;
+        std::string text_;
+
+        bool operator==(const Key& k) const
+        {
+            return face_ == k.face_ && point_size_ == k.point_size_
+                && resolution_ == k.resolution_ && text_ == k.text_;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const;
+    };
+
+    typedef std::list<std::pair<Key, Layout>> Entries;
+    typedef std::unordered_map<Key, Entries::iterator, KeyHash> Index;
+
+    TextLayoutCache(void);
+    void evict(void);
+
+    Entries entries_; //!< Most recently used first.
+    Index index_;
+    std::size_t capacity_;
+    unsigned long hits_, misses_, evictions_;
+};
+
+//! Render text from a single texture atlas.
+/*!
+   * Each point size (and resolution) used with the face is rasterized once,
+   * antialiased, into a page of glyphs stored in one GL_ALPHA texture that
+   * is shared by all sizes. Glyph metrics live in a flat per-page table
+   * indexed by the (latin1) character, so drawing and measuring a string
+   * never call FreeType or query GL state once its glyphs are resident.
+   * Whole strings are laid out once and kept in the TextLayoutCache.
+   *
+   * A string is drawn as a list of textured quads. Between begin() and
+   * end() the quads of every draw() call are collected and submitted with
+   * a single glDrawArrays, whatever their size or colour, so a whole menu
+   * or HUD is one call. Outside begin()/end() each draw() is its own batch.
+   *
+   * The foreground colour is applied per vertex, so changing it does not
+   * disturb the atlas. Character and string rotation are not supported,
+   * and the MODELVIEW matrix is never advanced.
+   */
+class Atlas : public Raster {
+public:
+    /*!
+     * \param file the filename which contains the font face.
+     * \param point_size the initial point size of the font to generate. A point
+     * is essentially 1/72th of an inch. Defaults to 12.
+     * \param resolution the pixel density of the display in dots per inch (DPI).
+     * Defaults to 100 DPI.
+     */
+    Atlas(const char* filename, float point_size = 12,
+          FT_UInt resolution = 100);
+    /*!
+     * \param face open FreeType FT_Face.
+     * \param point_size the initial point size of the font to generate. A point
+     * is essentially 1/72th of an inch. Defaults to 12.
+     * \param resolution the pixel density of the display in dots per inch (DPI).
+     * Defaults to 100 DPI.
+     */
+    Atlas(FT_Face face, float point_size = 12, FT_UInt resolution = 100);
+    /*!
+     * Releases the atlas texture.
+     */
+    ~Atlas(void);
+
+    /*!
+     * Start collecting the quads of subsequent draw() calls.
+     */
+    void begin(void);
+    /*!
+     * Submit everything collected since begin() in one draw call.
+     */
+    void end(void);
+
+    using Face::draw;
+    /*!
+     * Queue the (latin1) string at the given position, honouring the
+     * justification settings.
+     */
+    void draw(GLfloat x, GLfloat y, const char* s);
+
+    /*!
+     * Measure a character from the glyph table.
+     * \param c the (latin1) character to measure
+     * \return the bounding box of c.
+     */
+    BBox measure(unsigned char c);
+    /*!
+     * Measure a string from its cached layout.
+     * \param s string of (latin1) characters to measure
+     * \return the bounding box of s.
+     */
+    BBox measure(const char* s);
+
+protected:
+    //! Placement of one glyph in the atlas and its quad relative to the pen.
+    struct Glyph {
+        bool loaded_; //!< Rasterization has been attempted.
+        FT_UInt index_; //!< FreeType glyph index, 0 if the face lacks it.
+        GLfloat u0_, v0_, u1_, v1_; //!< Texture coordinates.
+        GLfloat x0_, y0_, x1_, y1_; //!< Quad in pixels from the pen.
+        GLfloat pad_; //!< Blank margin around the ink inside the quad.
+        GLfloat advance_; //!< Horizontal advance in pixels.
+    };
+
+    //! The glyphs of one point size and resolution.
+    struct Page {
+        float point_size_;
+        FT_UInt resolution_;
+        Glyph glyphs_[256];
+    };
+
+    //! Matches the GL_T2F_C4UB_V3F interleaved layout.
+    struct Vertex {
+        GLfloat u_, v_;
+        GLubyte c_[4];
+        GLfloat x_, y_, z_;
+    };
+
+    //! The page for the current point size and resolution.
+    virtual Page* page(void);
+    //! Ratio of drawn size to the size the current page was rasterized at.
+    virtual GLfloat scale(void) const { return 1; }
+    const Glyph& glyph(Page& page, unsigned char c);
+    const TextLayoutCache::Layout& layout(const char* s);
+    virtual void queue(GLfloat x, GLfloat y, const char* s);
+    virtual void flush(void);
+    void color(Vertex& v) const;
+
+    GLuint texture_;
+    std::vector<Vertex> vertices_;
+
+private:
+    void init(void);
+    bool rasterize(Page& page, unsigned char c);
+    void reset(void);
+    void renderGlyph(FT_Face face, FT_UInt glyph_index);
+    void clearCaches(void);
+
+    GLsizei texture_size_;
+    GLint shelf_x_, shelf_y_, shelf_height_;
+    unsigned int generation_;
+    std::vector<Page*> pages_;
+    Page* current_;
+    bool batching_;
+};
+
+//! Render text from a signed distance field atlas.
+/*!
+   * At construction every latin1 glyph of the face is rendered once at a
+   * reference size and converted to a signed distance field, stored as
+   * alpha in one linearly filtered texture. Text of any point size is
+   * drawn by scaling the reference quads, and both string and character
+   * rotation are applied to the quads, so after construction neither size
+   * nor rotation changes render anything through FreeType.
+   *
+   * Edges are recovered with the alpha test (alpha > 0.5), in the same
+   * single batched pass as the Atlas style. Because the test runs on the
+   * modulated alpha, the foreground alpha should be left at 1.
+   */
+class DistanceField : public Atlas {
+public:
+    /*!
+     * \param file the filename which contains the font face.
+     * \param point_size the initial point size of the font to generate. A point
+     * is essentially 1/72th of an inch. Defaults to 12.
+     * \param resolution the pixel density of the display in dots per inch (DPI).
+     * Defaults to 100 DPI.
+     */
+    DistanceField(const char* filename, float point_size = 12,
+                  FT_UInt resolution = 100);
+    /*!
+     * \param face open FreeType FT_Face.
+     * \param point_size the initial point size of the font to generate. A point
+     * is essentially 1/72th of an inch. Defaults to 12.
+     * \param resolution the pixel density of the display in dots per inch (DPI).
+     * Defaults to 100 DPI.
+     */
+    DistanceField(FT_Face face, float point_size = 12, FT_UInt resolution = 100);
+    /*!
+     * Releases the distance field page.
+     */
+    ~DistanceField(void);
+
+protected:
+    Page* page(void) { return &field_; }
+    GLfloat scale(void) const;
+    void queue(GLfloat x, GLfloat y, const char* s);
+    void flush(void);
+
+private:
+    void build(void);
+    void setCharSize(void) {}
+    void setRotationOffset(void) {}
+
+    Page field_;
+    GLsizei width_, height_;
+    std::vector<GLubyte> texels_;
+};
+
 } // Close OGLFT namespace
 #endif /* OGLFT_H */
@@ -9,10 +9,28 @@
 // --------------------------------------------------------------------------
 
 #include "game.h"
+#include "debris.h"
+#include "draw.h"
+#include "font.h"
+#include "gravity.h"
+#include "hud.h"
+#include "particle.h"
+#include "physics.h"
+#include "quality.h"
 #include "screen.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 const int FPS_SZ = 100;
 
+// How long the renderer waits for a snapshot before reading events again
+const unsigned int RENDER_WAIT_MS = 100;
+
+// How long the idle simulation sleeps when there is no input
+const unsigned int IDLE_WAIT_MS = 500;
+
 inline double fps(double wait)
 {
     static double times[FPS_SZ], avg;
@@ -31,8 +49,22 @@ inline double fps(double wait)
 
 double mFramerate;
 
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
 Game::Game()
     : mModel(Model::getInstance())
+    , mRunning(false)
+    , mReport(false)
+    , mFrames(0)
+    , mReportTime(SDL_GetTicks())
+    , mWaitForInput(false)
+    , mThreaded(false)
+    , mIdle(false)
+    , mIdlePublished(false)
     , dt(0)
     , mTime1(SDL_GetTicks())
     , mTime2(SDL_GetTicks())
@@ -44,7 +76,6 @@ Game::Game()
 #endif
 {
     Global::ship = new Ship(100, 100);
-    mModel.setPlayerPos();
     mLevel.setLevel(1);
     mMenuHandler.setMenu(&mGameMenu);
     mMenuHandler.setController(&mController);
@@ -77,44 +108,177 @@ void Game::setMode(GameMode mode)
 
 void Game::loop()
 {
-    while (1) {
-        if (!mController.isPaused() && (dt > 0)) {
-            mModel.update(dt);
-            if (mLevel.completed())
-                mLevel++;
-        } else {
-            mModel.draw(dt, false);
-        }
+    mRunning = true;
+    mThreaded = Config::getInstance().renderThread();
+    Quality::getInstance().setShared(!mThreaded);
 
-        mController.poll(dt);
-        delay();
+    if (mThreaded) {
+        // SDL only lets the thread that opened the window draw to it and
+        // read its events, so it is the simulation that moves
+        std::thread simulation(&Game::simulate, this);
 
-        if (mController.wantExit()) {
-            if (mMode == MENU) {
-                break;
-            } else {
-                setMode(MENU);
+        while (mRunning) {
+            bool exposed = mController.pump(mWaitForInput);
+            if (mSnapshots.wait(RENDER_WAIT_MS) || exposed) {
+                render(exposed);
             }
         }
+        simulation.join();
+    } else {
+        while (mRunning) {
+            bool exposed = mController.pump(mWaitForInput);
+            mRunning = tick();
+            render(exposed);
+        }
     }
 
+    HUD::shutdown();
+
+    // the backend closes its mixer device, so it has to go before SDL
+    delete Global::audio;
+    Global::audio = 0;
+
     SDL_Quit();
 }
 
-void Game::delay()
+void Game::simulate()
+{
+    dAllocateODEDataForThread(dAllocateMaskAll);
+
+    while (mRunning) {
+        if (isIdle()) {
+            mController.waitEvents(IDLE_WAIT_MS);
+        }
+        if (!tick()) {
+            break;
+        }
+    }
+    mRunning = false;
+
+    // the renderer may be asleep waiting for input
+    Controller::wake();
+
+    dCleanupODEAllDataForThread();
+}
+
+// Steps the world, handles input, then publishes what it looks like.
+// While idle nothing moves, so a snapshot is only published when input
+// may have changed the menu, or on the way into idle. Returns false once
+// the player has quit from the menu.
+
+bool Game::tick()
+{
+    mIdle = isIdle();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (!mIdle && (dt > 0)) {
+        mModel.update(dt);
+        if (mLevel.completed())
+            mLevel++;
+    }
+
+    bool input = mController.process(dt);
+
+    bool idle = isIdle();
+    if (!idle || input || !mIdlePublished) {
+        bool wasIdle = mIdlePublished;
+
+        mModel.record(mSnapshots.back(), dt, idle);
+        mSnapshots.publish();
+        mIdlePublished = idle;
+
+        // the renderer sleeps in pump() after drawing an idle snapshot
+        if (mThreaded && (idle || wasIdle)) {
+            Controller::wake();
+        }
+    }
+
+    if (!mIdle) {
+        Quality::getInstance().tick(elapsed(start));
+    }
+
+    delay();
+
+    if (mController.wantExit()) {
+        if (mMode == MENU) {
+            return false;
+        } else {
+            setMode(MENU);
+        }
+    }
+    return true;
+}
+
+// Draws the newest snapshot, if there is one the renderer has not drawn;
+// force draws the last one again
+
+void Game::render(bool force)
 {
-    if (mController.isPaused()) {
-        SDL_Delay(100);
+    if (!mSnapshots.acquire() && !force) {
+        return;
+    }
+
+    const Snapshot& snap = mSnapshots.front();
+    // Timed up to glFinish(), which waits for the drawing itself to be
+    // done (on the CPU, for software renderers) but not for the vertical
+    // retrace the flip may wait on, so vsync alone never reads as slow
+    if (!snap.idle) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mModel.render(snap);
+        draw::finish();
+        Quality::getInstance().frame(elapsed(start));
     } else {
+        mModel.render(snap);
+    }
+    draw::flipBuffers();
+    mWaitForInput = snap.idle;
+    mFrames++;
+
+    if (mReport.exchange(false)) {
+        report();
+    }
+}
+
+// The renderer's half of the periodic stats printed by delay()
+
+void Game::report()
+{
+    unsigned int now = SDL_GetTicks();
+    double elapsed = (now - mReportTime) / 1000.0;
+
+    fprintf(stderr, "render: %.2f fps, %lu snapshots not drawn\n",
+            elapsed > 0 ? mFrames / elapsed : 0, mSnapshots.skipped());
+    mFrames = 0;
+    mReportTime = now;
+
+    OGLFT::TextLayoutCache& text = OGLFT::TextLayoutCache::instance();
+    fprintf(stderr, "text layouts: %lu/%lu cached, %.1f%% hits, %lu evicted\n",
+            (unsigned long)text.size(), (unsigned long)text.capacity(),
+            text.hitRate() * 100, text.evictions());
+    text.resetStats();
+}
+
+void Game::delay()
+{
+    // idle ticks have already slept waiting for input
+    bool idle = mIdle || isIdle();
+    if (!idle) {
         SDL_Delay(mWait);
     }
 
     mTime1 = SDL_GetTicks();
     double delta = mTime1 - mTime2;
     dt = delta * (mController.slowMotion() ? .025 : .05);
-    mFramerate = fps(delta);
     mTime2 = SDL_GetTicks();
 
+    // a long wait for input is not a slow frame, and has nothing to report
+    if (idle) {
+        dt = std::min(dt, 1.5);
+        return;
+    }
+
+    mFramerate = fps(delta);
+
     if (!mController.isPaused() && (dt > 1.5)) {
         static bool speedWarn = true;
         if (speedWarn && (mFramerate < 50)) {
@@ -130,6 +294,65 @@ void Game::delay()
     static double cnt = 0;
     if (cnt > 50) {
         fprintf(stderr, "fps: %.2f\n", mFramerate), cnt = 0;
+
+        // the text and render lines come from the renderer's next frame
+        mReport = true;
+
+        Environ& environ = Environ::getInstance();
+        fprintf(stderr, "collision: %lu near pairs, %lu declined, %lu masked by category, %lu events\n",
+                environ.nearPairs(), environ.declinedPairs(), environ.maskedPairs(),
+                environ.events());
+        fprintf(stderr, "physics: %u threads, %lu contact islands, %.3f ms collide, %.3f ms step\n",
+                environ.threads(), environ.islands(),
+                environ.collideTime(), environ.stepTime());
+        fprintf(stderr, "contact cache: %lu pairs, %.1f%% hits\n",
+                (unsigned long)environ.contactCacheSize(), environ.contactCacheHitRate() * 100);
+        environ.resetContactCacheStats();
+        fprintf(stderr, "physics memory: %lu ODE heap allocs last step, %lu total, %lu KB live, "
+                        "step memory %lu KB in %lu blocks, %lu allocs\n",
+                environ.stepHeapAllocs(), environ.heapAllocs(), environ.heapBytes() / 1024,
+                environ.stepMemoryBytes() / 1024, environ.stepMemoryBlocks(),
+                environ.stepMemoryAllocs());
+
+        Missiles& missiles = Missiles::getInstance();
+        fprintf(stderr, "missiles: %lu in flight, %lu hits\n",
+                (unsigned long)missiles.size(), missiles.hits());
+
+        DebrisPool& debris = DebrisPool::getInstance();
+        fprintf(stderr, "debris: %lu pieces, %lu drawn\n",
+                (unsigned long)debris.size(), (unsigned long)debris.drawn());
+
+        ParticleSystem& particles = ParticleSystem::getInstance();
+        fprintf(stderr, "particles: %lu bursts, %lu spawned, scale %.2f\n",
+                particles.bursts(), particles.spawned(), particles.scale());
+        particles.resetStats();
+
+        Quality& quality = Quality::getInstance();
+        fprintf(stderr, "quality: level %d/%d, 90th percentile frame %.2f ms, tick %.2f ms\n",
+                quality.level(), Quality::MAX_LEVEL, quality.frameTime(), quality.tickTime());
+
+        static const char* TYPE_NAMES[ScreenObject::NUM_OBJECT_TYPES] = {
+            "player", "missile", "bogey", "fatso", "lunatic", "blackhole", "asteroid", "smarty"
+        };
+        fprintf(stderr, "visible:");
+        for (int t = 0; t < ScreenObject::NUM_OBJECT_TYPES; t++) {
+            ScreenObject::ObjectType type = (ScreenObject::ObjectType)t;
+            if (mModel.total(type) > 0)
+                fprintf(stderr, " %s %u/%u", TYPE_NAMES[t], mModel.visible(type), mModel.total(type));
+        }
+        fprintf(stderr, "\n");
+
+        Audio& audio = *Global::audio;
+        fprintf(stderr, "audio: %lu commands, %lu played, %lu coalesced, %lu culled, %lu stolen, %lu dropped, %lu overflows\n",
+                audio.commands(), audio.played(), audio.coalesced(), audio.culled(),
+                audio.stolen(), audio.dropped(), audio.overflows());
+        audio.resetStats();
+
+        Gravity& gravity = Gravity::getInstance();
+        if (gravity.sources() > 0)
+            fprintf(stderr, "gravity: %u sources, %u bodies, %u nodes, %.3f ms build, %.3f ms apply\n",
+                    gravity.sources(), gravity.bodies(), gravity.nodes(),
+                    gravity.buildTime(), gravity.applyTime());
     }
     cnt += dt;
 
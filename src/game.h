@@ -17,10 +17,12 @@
 #include "level.h"
 #include "menu.h"
 #include "model.h"
+#include "snapshot.h"
+
+#include <atomic>
 
 class Game {
 private:
-    friend class Lunatic;
     Game();
 
 public:
@@ -35,15 +37,39 @@ public:
         return instance;
     }
 
+    // Runs the game until the player quits. With [video] render_thread
+    // the simulation runs on a thread of its own and publishes a snapshot
+    // each tick, while this thread reads events and draws the newest
+    // snapshot; otherwise the two alternate here. While the game is idle
+    // both sides sleep until there is input.
     void loop();
     void delay();
 
     void setMode(GameMode);
     inline GameMode getMode() { return mMode; }
-    inline void drawMenu() { mGameMenu.draw(); }
+    inline void recordMenu(Snapshot::Menu& menu) { mGameMenu.record(menu); }
 
 private:
+    // paused or in the menu, where nothing moves
+    bool isIdle() { return mController.isPaused() || mMode == MENU; }
+
+    bool tick();
+    void simulate();
+    void render(bool force = false);
+    void report();
+
     Model& mModel;
+    SnapshotBuffer mSnapshots;
+    std::atomic<bool> mRunning, mReport;
+
+    // render thread
+    unsigned int mFrames;
+    unsigned int mReportTime;
+    bool mWaitForInput;
+
+    // simulation thread
+    bool mThreaded;
+    bool mIdle, mIdlePublished;
 
     Controller mController;
     PlayHandler mPlayHandler;
@@ -1,7 +1,10 @@
 #include "geom.h"
 #include "draw.h"
 
+#include <algorithm>
+#include <cstring>
 #include <map>
+#include <unordered_map>
 
 void Mesh::normalize(double)
 {
@@ -106,13 +109,11 @@ void Mesh::setMapMode(MapMode mode)
     }
 }
 
-extern unsigned int ASTEROID_TEXTURE;
-
 void Mesh::draw()
 {
     if (mHasTexture) {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, ASTEROID_TEXTURE);
+        glBindTexture(GL_TEXTURE_2D, mTextureId);
         glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
         draw::setColor(1, 1, 1, 1);
     }
@@ -135,3 +136,263 @@ void Mesh::draw()
         glDisable(GL_TEXTURE_2D);
     }
 }
+
+// --------------------------------------------------------------------------
+
+IndexedMesh::~IndexedMesh()
+{
+    if (mDisplayList)
+        glDeleteLists(mDisplayList, 1);
+}
+
+uint32_t IndexedMesh::addVertex(double x, double y, double z)
+{
+    uint32_t index = (uint32_t)numVertices();
+
+    mVertices.push_back((float)x);
+    mVertices.push_back((float)y);
+    mVertices.push_back((float)z);
+
+    mNormals.push_back(0);
+    mNormals.push_back(0);
+    mNormals.push_back(0);
+
+    mTexCoords.push_back(0);
+    mTexCoords.push_back(0);
+
+    return index;
+}
+
+void IndexedMesh::clear()
+{
+    mVertices.clear();
+    mNormals.clear();
+    mTexCoords.clear();
+    mIndices.clear();
+}
+
+void IndexedMesh::assign(const Mesh& mesh)
+{
+    clear();
+    mHasTexture = mesh.mHasTexture;
+    mTextureId = mesh.mTextureId;
+
+    mVertices.reserve(mesh.mTriangles.size() * 9);
+    mIndices.reserve(mesh.mTriangles.size() * 3);
+
+    std::vector<Triangle>::const_iterator i;
+    for (i = mesh.mTriangles.begin(); i != mesh.mTriangles.end(); ++i) {
+        const Vertex* v[3] = { &i->v1, &i->v2, &i->v3 };
+        for (int j = 0; j < 3; j++) {
+            uint32_t n = addVertex(v[j]->vertex.x, v[j]->vertex.y, v[j]->vertex.z);
+            mTexCoords[n * 2] = (float)v[j]->texture.x;
+            mTexCoords[n * 2 + 1] = (float)v[j]->texture.y;
+            mIndices.push_back(n);
+        }
+    }
+    weld();
+}
+
+namespace {
+struct PositionKey {
+    float p[3];
+
+    bool operator==(const PositionKey& k) const
+    {
+        return p[0] == k.p[0] && p[1] == k.p[1] && p[2] == k.p[2];
+    }
+};
+
+struct PositionHash {
+    std::size_t operator()(const PositionKey& k) const
+    {
+        uint32_t b[3];
+        memcpy(b, k.p, sizeof(b));
+        return (b[0] * 73856093u) ^ (b[1] * 19349663u) ^ (b[2] * 83492791u);
+    }
+};
+}
+
+void IndexedMesh::weld()
+{
+    const std::size_t n = numVertices();
+
+    std::unordered_map<PositionKey, uint32_t, PositionHash> seen;
+    seen.reserve(n);
+
+    std::vector<uint32_t> remap(n);
+    std::size_t unique = 0;
+
+    for (std::size_t i = 0; i < n; i++) {
+        PositionKey key;
+        memcpy(key.p, &mVertices[i * 3], sizeof(key.p));
+
+        auto r = seen.insert(std::make_pair(key, (uint32_t)unique));
+        if (r.second) {
+            if (unique != i) {
+                memcpy(&mVertices[unique * 3], &mVertices[i * 3], 3 * sizeof(float));
+                memcpy(&mNormals[unique * 3], &mNormals[i * 3], 3 * sizeof(float));
+                memcpy(&mTexCoords[unique * 2], &mTexCoords[i * 2], 2 * sizeof(float));
+            }
+            unique++;
+        }
+        remap[i] = r.first->second;
+    }
+
+    mVertices.resize(unique * 3);
+    mNormals.resize(unique * 3);
+    mTexCoords.resize(unique * 2);
+
+    for (std::size_t i = 0; i < mIndices.size(); i++) {
+        mIndices[i] = remap[mIndices[i]];
+    }
+}
+
+void IndexedMesh::normalize(double)
+{
+    const std::size_t n = numVertices();
+    assert(n > 0);
+
+    float min[3], max[3];
+    for (int k = 0; k < 3; k++) {
+        min[k] = max[k] = mVertices[k];
+    }
+
+    for (std::size_t i = 0; i < n; i++) {
+        const float* v = &mVertices[i * 3];
+        for (int k = 0; k < 3; k++) {
+            if (min[k] > v[k])
+                min[k] = v[k];
+            if (max[k] < v[k])
+                max[k] = v[k];
+        }
+    }
+
+    float maxd = max[0] - min[0];
+    for (int k = 1; k < 3; k++) {
+        if (maxd < max[k] - min[k])
+            maxd = max[k] - min[k];
+    }
+
+    float c[3];
+    for (int k = 0; k < 3; k++) {
+        c[k] = (min[k] + max[k]) / 2;
+    }
+
+    for (std::size_t i = 0; i < n; i++) {
+        float* v = &mVertices[i * 3];
+        for (int k = 0; k < 3; k++) {
+            v[k] = (v[k] - c[k]) / maxd;
+        }
+    }
+}
+
+void IndexedMesh::smooth()
+{
+    std::fill(mNormals.begin(), mNormals.end(), 0.f);
+
+    // accumulate the unit face normal into each corner of the face
+    Coord3<double> a, b, c, fn;
+    for (std::size_t t = 0; t < mIndices.size(); t += 3) {
+        a = vertex(mIndices[t]);
+        b = vertex(mIndices[t + 1]);
+        c = vertex(mIndices[t + 2]);
+
+        fn = (b - a) ^ (c - a);
+        fn.normalize();
+
+        for (int j = 0; j < 3; j++) {
+            float* nv = &mNormals[mIndices[t + j] * 3];
+            nv[0] += (float)fn.x;
+            nv[1] += (float)fn.y;
+            nv[2] += (float)fn.z;
+        }
+    }
+
+    for (std::size_t i = 0; i < mNormals.size(); i += 3) {
+        float* nv = &mNormals[i];
+        float l = sqrtf(nv[0] * nv[0] + nv[1] * nv[1] + nv[2] * nv[2]);
+        if (l > 0) {
+            nv[0] /= l;
+            nv[1] /= l;
+            nv[2] /= l;
+        }
+    }
+}
+
+void IndexedMesh::setMapMode(Mesh::MapMode mode)
+{
+    const std::size_t n = numVertices();
+
+    for (std::size_t i = 0; i < n; i++) {
+        const float* v = &mVertices[i * 3];
+        float* t = &mTexCoords[i * 2];
+
+        switch (mode) {
+        case Mesh::PLANAR:
+            t[0] = v[0] + .5f;
+            t[1] = v[1] + .5f;
+            break;
+
+        case Mesh::CYLINDRICAL:
+            t[0] = (float)((1 + atan2(v[0], v[1]) / M_PI) / 2);
+            t[1] = v[2] + .5f;
+            break;
+        }
+    }
+}
+
+void IndexedMesh::drawArrays()
+{
+    if (mIndices.empty())
+        return;
+
+    if (mHasTexture) {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, mTextureId);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        draw::setColor(1, 1, 1, 1);
+
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, 0, &mTexCoords[0]);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &mVertices[0]);
+    glNormalPointer(GL_FLOAT, 0, &mNormals[0]);
+
+    glDrawElements(GL_TRIANGLES, (GLsizei)mIndices.size(), GL_UNSIGNED_INT, &mIndices[0]);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    if (mHasTexture) {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+    }
+}
+
+void IndexedMesh::genDisplayList()
+{
+    if (mDisplayList)
+        glDeleteLists(mDisplayList, 1);
+
+    mDisplayList = glGenLists(1);
+    glNewList(mDisplayList, GL_COMPILE);
+    drawArrays();
+    glEndList();
+}
+
+void IndexedMesh::drawDisplayList()
+{
+    glCallList(mDisplayList);
+}
+
+void IndexedMesh::draw()
+{
+    if (mDisplayList)
+        drawDisplayList();
+    else
+        drawArrays();
+}
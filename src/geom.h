@@ -3,6 +3,7 @@
 
 #include "coord.h"
 
+#include <cstdint>
 #include <vector>
 
 struct Vertex {
@@ -99,10 +100,7 @@ public:
     {
     }
 
-    void genDisplayList();
     void draw();
-    void drawDisplayList();
-    void drawArrays();
 
     void smooth();
     void normalize(double size = 1);
@@ -112,4 +110,82 @@ public:
     void setMapMode(MapMode m);
 };
 
+// --------------------------------------------------------------------------
+//
+// CLASS: IndexedMesh
+//
+// Shared-vertex counterpart of Mesh. Positions, normals and texture
+// coordinates are stored once per vertex in flat float arrays, and faces
+// refer to them through a uint32 index buffer (three indices per triangle).
+// Because neighbouring faces share their vertices, smoothing is a single
+// pass over the index buffer instead of a position-keyed map, and the
+// whole mesh can be handed to GL with one glDrawElements call.
+//
+// --------------------------------------------------------------------------
+
+class IndexedMesh {
+public:
+    std::vector<float> mVertices; // x, y, z per vertex
+    std::vector<float> mNormals; // x, y, z per vertex
+    std::vector<float> mTexCoords; // u, v per vertex
+    std::vector<uint32_t> mIndices; // three per triangle
+    bool mHasTexture;
+    unsigned int mDisplayList, mTextureId;
+
+    IndexedMesh()
+        : mHasTexture(true)
+        , mDisplayList(0)
+        , mTextureId(0)
+    {
+    }
+
+    ~IndexedMesh();
+
+    inline std::size_t numVertices() const { return mVertices.size() / 3; }
+    inline std::size_t numTriangles() const { return mIndices.size() / 3; }
+
+    inline Coord3<double> vertex(uint32_t i) const
+    {
+        const float* v = &mVertices[i * 3];
+        return Coord3<double>(v[0], v[1], v[2]);
+    }
+
+    inline void setVertex(uint32_t i, const Coord3<double>& v)
+    {
+        float* p = &mVertices[i * 3];
+        p[0] = v.x, p[1] = v.y, p[2] = v.z;
+    }
+
+    uint32_t addVertex(double x, double y, double z);
+
+    inline void addTriangle(uint32_t a, uint32_t b, uint32_t c)
+    {
+        mIndices.push_back(a);
+        mIndices.push_back(b);
+        mIndices.push_back(c);
+    }
+
+    void clear();
+
+    // build from a triangle soup, merging corners with identical positions
+    void assign(const Mesh& mesh);
+
+    // merge vertices with identical positions and drop the duplicates
+    void weld();
+
+    void smooth();
+    void normalize(double size = 1);
+    void setMapMode(Mesh::MapMode m);
+
+    void setTexture(unsigned int ti) { mTextureId = ti; }
+
+    // genDisplayList() compiles the arrays into a display list, which puts
+    // the mesh in server memory on every GL we run on (including software
+    // renderers without buffer objects).
+    void genDisplayList();
+    void drawDisplayList();
+    void drawArrays();
+    void draw();
+};
+
 #endif // SSC_GEOM_H
@@ -0,0 +1,84 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "gravity.h"
+
+#include <chrono>
+
+// Force between two unit masses at unit distance. A blackhole pulls the
+// ship with about half its thrust from 200 units away.
+const double GRAVITY_CONSTANT = 200.0;
+
+// How strongly each type is pulled, indexed by ScreenObject::ObjectType.
+// The player is pulled in fully; bogeys drift a little so they can be
+// lured in.
+static const double RESPONSE[] = {
+    1.0, // PLAYER_TYPE
+    0.0, // MISSILE_TYPE
+    0.25, // BOGEY_TYPE
+    0.0, // FATSO_TYPE
+    0.0, // LUNATIC_TYPE
+    0.0, // BLACKHOLE_TYPE
+    0.0, // ASTEROID_TYPE
+    0.0, // SMARTY_TYPE
+};
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+Gravity::Gravity()
+    : mBuildTime(0)
+    , mApplyTime(0)
+{
+}
+
+void Gravity::update(ScreenObject* head)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    mField.clear();
+    mAffected.clear();
+
+    for (ScreenObject* i = head; i; i = i->next) {
+        if (i->mGravity && i->isAlive())
+            mField.addSource(i->mPosition.x, i->mPosition.y, i->mass);
+    }
+    mField.build();
+
+    mBuildTime = elapsed(start);
+    start = std::chrono::steady_clock::now();
+
+    if (mField.sources() > 0) {
+        for (ScreenObject* i = head; i; i = i->next) {
+            double response = RESPONSE[i->type()];
+            if (response == 0 || !i->isAlive())
+                continue;
+
+            mField.addBody(i->mPosition.x, i->mPosition.y,
+                           GRAVITY_CONSTANT * response * i->mass);
+            mAffected.push_back(i);
+        }
+
+        mField.evaluate();
+
+        // ODE is not thread safe, so the forces go in from here
+
+        for (std::size_t n = 0; n < mAffected.size(); n++) {
+            double fx = mField.fx(n), fy = mField.fy(n);
+            mAffected[n]->mGravityAffect.set(fx, fy);
+            mAffected[n]->PhysicsObject::accelerate(fx, fy, 0);
+        }
+    }
+
+    mApplyTime = elapsed(start);
+}
@@ -0,0 +1,64 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_GRAVITY_H
+#define SSC_GRAVITY_H
+
+#include "barneshut.h"
+#include "object.h"
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: Gravity
+//
+// Pulls objects towards every ScreenObject that has mGravity set (the
+// blackholes). Once per tick, before the world is stepped, update()
+// collects the sources into a Barnes-Hut quadtree and then walks it once
+// for each affected body, so the cost grows with bodies * log(sources)
+// rather than bodies * sources. Distant clusters of sources are treated
+// as a single mass at their centre of mass; the field itself is worked
+// out by BarnesHut.
+//
+// How strongly a body responds depends on its type; see RESPONSE in
+// gravity.cc. The forces are computed in a pass that only reads the tree
+// and is split across threads for large body counts, then added to the
+// bodies with PhysicsObject::accelerate on the calling thread.
+//
+// --------------------------------------------------------------------------
+
+class Gravity {
+public:
+    static Gravity& getInstance()
+    {
+        static Gravity instance;
+        return instance;
+    }
+
+    void update(ScreenObject* head);
+
+    // statistics for the last update
+    unsigned int sources() { return mField.sources(); }
+    unsigned int bodies() { return mField.bodies(); }
+    unsigned int nodes() { return mField.nodes(); }
+    unsigned int threads() { return mField.threads(); }
+    double buildTime() { return mBuildTime; }
+    double applyTime() { return mApplyTime; }
+
+private:
+    Gravity();
+
+    BarnesHut mField;
+    std::vector<ScreenObject*> mAffected; // in the order of the field's bodies
+    double mBuildTime, mApplyTime;
+};
+
+#endif // SSC_GRAVITY_H
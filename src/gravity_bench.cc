@@ -0,0 +1,110 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+// Times the gravity field over synthetic scenes far larger than a level
+// ever holds: 1 to 100 blackholes pulling 10000 bodies spread over the
+// default 4000 x 4000 game area. Each scene is solved a number of times
+// and the mean build and evaluate times per tick are printed, next to a
+// direct all-pairs sum for comparison and the error of the tree's
+// approximation against it, relative to the typical force.
+//
+//     gravity_bench [bodies] [ticks]
+
+#include "barneshut.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const double AREA = 4000;
+const double BLACKHOLE_MASS = 500;
+const double BODY_SCALE = 200;
+const double SOFTENING = 40;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+static double place() { return drand48() * AREA; }
+
+int main(int argc, char** argv)
+{
+    unsigned int bodies = argc > 1 ? atoi(argv[1]) : 10000;
+    unsigned int ticks = argc > 2 ? atoi(argv[2]) : 100;
+    const unsigned int SOURCES[] = { 1, 2, 5, 10, 20, 50, 100 };
+
+    printf("%u bodies, %u ticks\n", bodies, ticks);
+    printf("%8s %10s %12s %8s %8s %12s %10s\n",
+           "sources", "nodes", "build ms", "eval ms", "threads", "direct ms", "rms error");
+
+    BarnesHut field;
+
+    for (unsigned int s : SOURCES) {
+        srand48(s);
+
+        std::vector<double> sx(s), sy(s), bx(bodies), by(bodies);
+        for (unsigned int i = 0; i < s; i++)
+            sx[i] = place(), sy[i] = place();
+        for (unsigned int n = 0; n < bodies; n++)
+            bx[n] = place(), by[n] = place();
+
+        double build = 0, evaluate = 0;
+
+        for (unsigned int t = 0; t < ticks; t++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            field.clear();
+            for (unsigned int i = 0; i < s; i++)
+                field.addSource(sx[i], sy[i], BLACKHOLE_MASS);
+            field.build();
+
+            build += elapsed(start);
+            start = std::chrono::steady_clock::now();
+
+            for (unsigned int n = 0; n < bodies; n++)
+                field.addBody(bx[n], by[n], BODY_SCALE);
+            field.evaluate();
+
+            evaluate += elapsed(start);
+        }
+
+        // the same field summed over every pair, once, to show what the
+        // tree saves and what its approximation costs
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double error = 0, total = 0;
+
+        for (unsigned int n = 0; n < bodies; n++) {
+            double fx = 0, fy = 0;
+            for (unsigned int i = 0; i < s; i++) {
+                double dx = sx[i] - bx[n], dy = sy[i] - by[n];
+                double r2 = dx * dx + dy * dy + SOFTENING * SOFTENING;
+                double f = BODY_SCALE * BLACKHOLE_MASS / (r2 * sqrt(r2));
+                fx += dx * f, fy += dy * f;
+            }
+
+            double ex = field.fx(n) - fx, ey = field.fy(n) - fy;
+            error += ex * ex + ey * ey;
+            total += fx * fx + fy * fy;
+        }
+
+        double direct = elapsed(start);
+        error = total > 0 ? sqrt(error / total) : 0;
+
+        printf("%8u %10lu %12.3f %8.3f %8u %12.3f %9.2f%%\n",
+               s, (unsigned long)field.nodes(), build / ticks, evaluate / ticks,
+               field.threads(), direct, error * 100);
+    }
+
+    return 0;
+}
@@ -66,21 +66,15 @@ MenuHandler::MenuHandler()
 {
 }
 
-static bool canmenu = true;
-static double menutm = 0;
-
 static bool mup = false, mdown = false, mleft = false, mright = false, mexec = false;
 
-void MenuHandler::process(double dt)
+// Each key press arrives as one event and is acted on once, on the tick
+// that handles it. The menu is only processed when there is input, so
+// there is no timer to debounce against.
+
+void MenuHandler::process(double)
 {
-    menutm += dt;
-    if (menutm > 10) {
-        menutm = 0;
-        canmenu = true;
-    }
-    if (!canmenu) {
-        return;
-    } else if (mup) {
+    if (mup) {
         mGameMenu->moveUp();
     } else if (mdown) {
         mGameMenu->moveDown();
@@ -93,7 +87,6 @@ void MenuHandler::process(double dt)
     }
 
     mup = false, mdown = false, mexec = false, mleft = false, mright = false;
-    canmenu = false;
 }
 
 void MenuHandler::pressKey(SDLKey c)
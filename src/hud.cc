@@ -9,23 +9,34 @@
 // --------------------------------------------------------------------------
 
 #include "hud.h"
+#include "config.h"
 #include "draw.h"
+#include "font.h"
 #include "graph.h"
-#include "model.h"
+#include "menu.h"
+#include "quality.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Size of the radar on screen, and of its texture in texels
+const int RADAR_SIZE = 100;
+const int RADAR_OFFSET = 10;
+
+// The texture is a power of two; the radar uses the corner of it
+const int RADAR_TEXTURE_SIZE = 128;
 
 HUD::HUD()
-    : ship(0)
-    , mShowRadar(false)
+    : mShowRadar(false)
+    , mRadarTexture(0)
+    , mRadarUpdated(0)
 {
 }
 
 const char* HUD::SPEED_TEXT = "Speed:";
 const char* HUD::ANGLE_TEXT = "Angle:";
-
-void HUD::update(Ship* s)
-{
-    ship = s;
-}
+const char* HUD::QUALITY_TEXT = "Quality:";
 
 void drawForce(int x, int y, int percent)
 {
@@ -36,7 +47,7 @@ void drawForce(int x, int y, int percent)
     draw::box(x, y, x + percent, y + 10);
 }
 
-void HUD::draw()
+void HUD::draw(const Snapshot& snap)
 {
     draw::setMode(draw::DRAW_2D);
 
@@ -46,41 +57,39 @@ void HUD::draw()
     draw::setColor(0, 0, .75, .4);
     draw::box(0, yres - 40, xres, yres);
 
-    drawForce(10, yres - 31, (int)(ship->shield.getStrength() * 100));
-    drawForce(10, yres - 19, (int)(ship->mLife * 100));
+    const Snapshot::Player& ship = snap.ship;
 
-    if (mShowRadar) {
-        // draw radar
+    drawForce(10, yres - 31, (int)(ship.shield * 100));
+    drawForce(10, yres - 19, (int)(ship.life * 100));
 
-        int height = 100,
-            width = 100,
-            offx = 10,
-            offy = 10;
+    // speed and heading readouts, drawn as one batch
+    OGLFT::Atlas* font = uiFont();
+    char value[16];
+    double angle = fmod(DEG(ship.rotation), 360);
+    if (angle < 0) {
+        angle += 360;
+    }
 
-        // draw frame
-        draw::setColor(1, 1, 1);
-        draw::rect(offx - 1, offy - 1, offx + width + 1, offy + height + 1, 0, true);
+    font->setPointSize(10);
+    font->setForegroundColor(1, 1, 1);
+    font->begin();
 
-        // draw background
-        draw::setColor(0, 0, 0, 0.5f);
-        draw::box(offx, offy, offx + width, offy + height);
+    font->draw(130, yres - 26, SPEED_TEXT);
+    snprintf(value, sizeof(value), "%.1f", ship.speed);
+    font->draw(135 + font->measure(SPEED_TEXT).advance_.dx_, yres - 26, value);
 
-        // draw points
+    font->draw(230, yres - 26, ANGLE_TEXT);
+    snprintf(value, sizeof(value), "%d", (int)angle);
+    font->draw(235 + font->measure(ANGLE_TEXT).advance_.dx_, yres - 26, value);
 
-        draw::startPoints();
+    font->draw(330, yres - 26, QUALITY_TEXT);
+    snprintf(value, sizeof(value), "%d/%d", snap.quality, Quality::MAX_LEVEL);
+    font->draw(335 + font->measure(QUALITY_TEXT).advance_.dx_, yres - 26, value);
 
-        for (ScreenObject* i = Model::getInstance().getHead(); i != 0; i = i->next) {
-            if (i->isAlive()) {
-                const ScreenObject& obj = *i;
-                int x = (int)obj.mPosition.x,
-                    y = (int)obj.mPosition.y;
+    font->end();
 
-                draw::setColor(obj.r, obj.g, obj.b);
-                draw::point(offx + (int)((x / (double)Screen::maxX()) * width),
-                            offy + (int)((y / (double)Screen::maxY()) * height));
-            }
-        }
-        draw::endPoints();
+    if (mShowRadar) {
+        drawRadar(snap);
     }
     draw::setMode(draw::DRAW_3D);
 }
@@ -88,3 +97,105 @@ void HUD::draw()
 void HUD::initialize()
 {
 }
+
+void HUD::release()
+{
+    if (mRadarTexture) {
+        glDeleteTextures(1, &mRadarTexture);
+        mRadarTexture = 0;
+    }
+}
+
+// Bins every live object into the radar texels and uploads the result
+
+void HUD::updateRadar(const Snapshot& snap)
+{
+    mRadarSum.assign(RADAR_SIZE * RADAR_SIZE * 4, 0);
+
+    double sx = RADAR_SIZE / (double)Screen::maxX(),
+           sy = RADAR_SIZE / (double)Screen::maxY();
+
+    for (std::size_t n = 0; n < snap.blips.size(); n++) {
+        const Snapshot::Blip& blip = snap.blips[n];
+
+        int x = std::min(std::max((int)(blip.x * sx), 0), RADAR_SIZE - 1),
+            y = std::min(std::max((int)(blip.y * sy), 0), RADAR_SIZE - 1);
+
+        float* texel = &mRadarSum[(y * RADAR_SIZE + x) * 4];
+        texel[0] += blip.r;
+        texel[1] += blip.g;
+        texel[2] += blip.b;
+        texel[3] += 1;
+    }
+
+    mRadarPixels.resize(RADAR_SIZE * RADAR_SIZE * 4);
+
+    for (int n = 0; n < RADAR_SIZE * RADAR_SIZE; n++) {
+        const float* texel = &mRadarSum[n * 4];
+        unsigned char* pixel = &mRadarPixels[n * 4];
+
+        if (texel[3] == 0) {
+            pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+            continue;
+        }
+
+        // one object keeps its own color; each doubling brightens it
+        float scale = (1 + .25f * log2f(texel[3])) / texel[3];
+        for (int c = 0; c < 3; c++) {
+            pixel[c] = (unsigned char)(std::min(1.0f, texel[c] * scale) * 255);
+        }
+        pixel[3] = 255;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, mRadarTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, RADAR_SIZE, RADAR_SIZE,
+                    GL_RGBA, GL_UNSIGNED_BYTE, &mRadarPixels[0]);
+}
+
+void HUD::drawRadar(const Snapshot& snap)
+{
+    int offx = RADAR_OFFSET,
+        offy = RADAR_OFFSET,
+        size = RADAR_SIZE;
+
+    if (!mRadarTexture) {
+        std::vector<unsigned char> blank(RADAR_TEXTURE_SIZE * RADAR_TEXTURE_SIZE * 4, 0);
+
+        glGenTextures(1, &mRadarTexture);
+        glBindTexture(GL_TEXTURE_2D, mRadarTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, RADAR_TEXTURE_SIZE, RADAR_TEXTURE_SIZE, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, &blank[0]);
+        mRadarUpdated = 0;
+    }
+
+    // refreshed less often as quality drops
+    unsigned int rate = std::max(1u, Config::getInstance().radarRate());
+    unsigned int period = 1000 / rate * Quality::getInstance().radarInterval();
+    unsigned int now = SDL_GetTicks();
+    if (mRadarUpdated == 0 || now - mRadarUpdated >= period) {
+        updateRadar(snap);
+        mRadarUpdated = now ? now : 1;
+    }
+
+    // draw frame
+    draw::setColor(1, 1, 1);
+    draw::rect(offx - 1, offy - 1, offx + size + 1, offy + size + 1, 0, true);
+
+    // draw background
+    draw::setColor(0, 0, 0, 0.5f);
+    draw::box(offx, offy, offx + size, offy + size);
+
+    // draw the objects
+    float extent = RADAR_SIZE / (float)RADAR_TEXTURE_SIZE;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, mRadarTexture);
+    draw::setColor(1, 1, 1);
+    draw::texturedBox(offx, offy, offx + size, offy + size, extent, extent);
+    glDisable(GL_TEXTURE_2D);
+}
@@ -11,9 +11,26 @@
 #ifndef SSC_HUD_H
 #define SSC_HUD_H
 
-#include "ship.h"
+#include "snapshot.h"
 
 #include <memory>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: HUD
+//
+// Draws the shield, life, speed and heading of the ship, the current
+// quality level, and the radar, from a Snapshot.
+//
+// The radar is not drawn object by object each frame. Every object is
+// binned into a small texture, one texel per radar pixel, at [video]
+// radar_rate times a second, or less at low quality; in between, the
+// last texture is drawn as a single quad. Objects sharing a texel are
+// averaged, and the texel is brightened with the count so crowds stand
+// out.
+//
+// --------------------------------------------------------------------------
 
 class HUD {
 public:
@@ -32,15 +49,28 @@ public:
         getInstance().initialize();
     }
 
+    // Frees the radar texture; called while the GL context is still
+    // there, since the instance itself outlives it.
+    static void shutdown()
+    {
+        getInstance().release();
+    }
+
     void toggleRadar() { mShowRadar = !mShowRadar; }
-    void update(Ship*);
-    void draw();
+    void draw(const Snapshot& snap);
 
 private:
-    Ship* ship;
     bool mShowRadar;
 
+    unsigned int mRadarTexture;
+    unsigned int mRadarUpdated;
+    std::vector<float> mRadarSum;
+    std::vector<unsigned char> mRadarPixels;
+
     void initialize();
+    void release();
+    void updateRadar(const Snapshot& snap);
+    void drawRadar(const Snapshot& snap);
 
     //  -- statics --
 
@@ -48,6 +78,7 @@ private:
 
     static const char* SPEED_TEXT;
     static const char* ANGLE_TEXT;
+    static const char* QUALITY_TEXT;
 
     HUD();
 };
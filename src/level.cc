@@ -17,8 +17,6 @@
 #include "lunatic.h"
 #include "smarty.h"
 
-static float pos[3] = { 0, 0, 0 };
-
 Level::Level()
 {
 }
@@ -47,7 +45,7 @@ void Level::operator++(int)
 
     level++;
 
-    Global::audio->playSound(Audio::POWER, pos);
+    Global::audio->playSound(Audio::POWER, 0);
     for (i = 0; i < ((MAX_BOGEYS * level) >> 4); i++) {
         (void)new Bogey((rand() % Screen::maxX() / 50) * (double)50,
                         (rand() % Screen::maxY() / 50) * (double)50);
@@ -10,8 +10,8 @@
 
 #include "lunatic.h"
 #include "draw.h"
-#include "game.h"
 #include "global.h"
+#include "snapshot.h"
 
 const unsigned int LUNATIC_MAX_SPEED = 7;
 const unsigned int LUNATIC_RADIUS = 7;
@@ -435,27 +435,39 @@ void Lunatic::move(double dt)
     ScreenObject::move(dt);
 }
 
-bool Lunatic::collision(ScreenObject& obj)
+// Lunatics never bounce anything, but they drag on whatever passes
+// through them.
+
+void Lunatic::collided(ScreenObject& obj, const CollisionEvent&)
+{
+    double dt = Environ::getInstance().stepSize();
+    PhysicsObject& pobj = obj;
+    pobj.accelerate(-pobj.mVelocity.x * dt * 2, -pobj.mVelocity.y * dt * 2, 0);
+}
+
+// Only the player's missiles kill a lunatic; the bogeys' fly through.
+
+bool Lunatic::shot(ObjectType owner)
 {
-    static float pos[3] = { 0.0, 0.0, 0.0 };
+    if (owner != PLAYER_TYPE) {
+        return false;
+    }
 
-    if ((obj.type() == MISSILE_TYPE) && (obj.ownerType() == PLAYER_TYPE)) {
+    if (isAlive()) {
         setState(DYING);
+        float pos[3] = { (float)mPosition.x, (float)mPosition.y, 0 };
         Global::audio->playSound(Audio::EXPLO_POP, pos);
         mExplosion.init(*this);
     }
-    double dt = Game::getInstance().dt;
-    PhysicsObject& pobj = obj;
-    pobj.accelerate(-pobj.mVelocity.x * dt * 2, -pobj.mVelocity.y * dt * 2, 0);
-    return false;
+    return true;
 }
 
-void Lunatic::draw()
+void Lunatic::record(Snapshot& snap)
 {
     if (isAlive()) {
-        draw::setColor(r, g, b, alpha);
-        draw::sphere(mPosition, radius);
-    } else if (isDying()) {
-        mExplosion.draw();
+        Snapshot::Item& item = snap.addItem(Snapshot::sphere);
+        item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
+        item.r = r, item.g = g, item.b = b, item.a = alpha;
+        item.radius = radius;
     }
 }
@@ -23,11 +23,13 @@ public:
     Lunatic();
     ~Lunatic();
 
-    void draw();
+    void record(Snapshot& snap);
 
     void rotate(double amt);
     void move(double dt);
-    bool collision(ScreenObject& other);
+    bool collision(ScreenObject&) { return false; }
+    void collided(ScreenObject& other, const CollisionEvent& e);
+    bool shot(ObjectType owner);
 
     double alpha;
     bool dir;
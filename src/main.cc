@@ -8,20 +8,23 @@
 //
 // --------------------------------------------------------------------------
 
+#include "asset.h"
 #include "asteroid.h"
 #include "draw.h"
 #include "game.h"
 #include "graph.h"
+#include "menu.h"
 
 int main(int argc, char** argv)
 {
     Config& conf = Config::getInstance();
     conf.handleArguments(argc, argv);
 
-    srand(time(NULL));
-    Global::audio = new AudioSDLMixer();
-    Global::audio->setSoundVolume(conf.soundVol());
+    // read and decode the data files while the window and audio come up
+    AssetManager& assets = AssetManager::getInstance();
+    assets.startLoading();
 
+    srand(time(NULL));
     dInitODE();
     Screen::init();
 
@@ -31,8 +34,16 @@ int main(int argc, char** argv)
         conf.getColorDepth(),
         conf.fullscreen());
 
+    Global::audio = Audio::create();
+    Global::audio->setSoundVolume(conf.soundVol());
+
+    assets.upload();
+
+    // build the interface font now rather than on the first menu frame;
+    // the distance field style takes a while to render
+    uiFont();
+
     Game::getInstance().loop();
 
-    // not reached
     return 0;
 }
@@ -1,22 +1,42 @@
 #include "menu.h"
+#include "asset.h"
+#include "config.h"
+#include "draw.h"
 #include "font.h"
 #include "game.h"
 #include "screen.h"
 
-OGLFT::Monochrome* face = 0;
+static OGLFT::Atlas* font = 0;
 
-void DrawHeading()
+OGLFT::Atlas* uiFont()
 {
-    draw::setColor(0, 0, 0, .5);
-    draw::box(0, 0, Screen::mDisplay.x, Screen::mDisplay.y);
-    if (!face) {
-        face = new OGLFT::Monochrome("/usr/local/share/ssc/Vera.ttf");
-        if (!face || !face->isValid()) {
+    if (!font) {
+        // the font file stays resident in the asset manager, so FreeType
+        // can read it straight from memory
+        AssetManager& assets = AssetManager::getInstance();
+        std::size_t size;
+        const unsigned char* data = assets.bytes(assets.find("Vera.ttf"), &size);
+        FT_Face ft_face;
+        if (data && !FT_New_Memory_Face(OGLFT::Library::instance(), data, (FT_Long)size, 0, &ft_face)) {
+            if (Config::getInstance().sdfText())
+                font = new OGLFT::DistanceField(ft_face);
+            else
+                font = new OGLFT::Atlas(ft_face);
+        }
+        if (!font || !font->isValid()) {
             fprintf(stderr, "Could not open Vera.ttf!\n");
             exit(0);
         }
     }
+    return font;
+}
 
+void DrawHeading()
+{
+    draw::setColor(0, 0, 0, .5);
+    draw::box(0, 0, Screen::mDisplay.x, Screen::mDisplay.y);
+
+    OGLFT::Atlas* face = uiFont();
     face->setForegroundColor(1, 1, 1);
     face->setPointSize(24);
     face->draw(5, Screen::mDisplay.y - 30, "SSC: Strategic Space Combat");
@@ -30,24 +50,39 @@ GameMenu::GameMenu()
     exec(0);
 }
 
-void GameMenu::draw()
+void GameMenu::record(Snapshot::Menu& menu)
+{
+    menu.shown = true;
+    menu.selected = mSelected;
+    menu.count = mNumMenus;
+    for (unsigned int i = 0; i < mNumMenus; ++i) {
+        menu.items[i] = mMenuItem[i].text;
+    }
+}
+
+void GameMenu::draw(const Snapshot::Menu& menu)
 {
     draw::setMode(draw::DRAW_2D);
+
+    // heading and items go out as one batch
+    OGLFT::Atlas* face = uiFont();
+    face->begin();
     DrawHeading();
 
     face->setPointSize(14);
     int xo = 100, yo = 150;
 
-    for (unsigned int i = 0; i < mNumMenus; ++i) {
-        if (mSelected == i) {
+    for (unsigned int i = 0; i < menu.count; ++i) {
+        if (menu.selected == i) {
             face->setForegroundColor(1, 1, 0);
         } else {
             face->setForegroundColor(1, 1, 1);
         }
 
         face->draw(xo, Screen::mDisplay.y - yo - 20 * i,
-                   mMenuItem[i].text);
+                   menu.items[i]);
     }
+    face->end();
     draw::setMode(draw::DRAW_3D);
 }
 
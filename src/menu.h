@@ -2,6 +2,15 @@
 #define SSC_MENU_H
 
 #include "control.h"
+#include "snapshot.h"
+
+namespace OGLFT {
+class Atlas;
+}
+
+//! The face used for all menu and HUD text, created on first use.
+
+OGLFT::Atlas* uiFont();
 
 //! \enum MenuAction
 //
@@ -36,12 +45,13 @@ struct MenuItem {
 
 //! \class GameMenu
 //
-//! Draws and maintains the menu state.
+//! Maintains the menu state, and draws it from a Snapshot.
 
 class GameMenu {
 public:
     GameMenu();
-    void draw();
+    void record(Snapshot::Menu& menu);
+    static void draw(const Snapshot::Menu& menu);
     void exec(Controller* c);
 
     void moveUp();
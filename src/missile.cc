@@ -9,123 +9,247 @@
 // --------------------------------------------------------------------------
 
 #include "missile.h"
+#include "asset.h"
 #include "common.h"
 #include "draw.h"
 #include "screen.h"
+#include "snapshot.h"
+#include "spatial.h"
 
 const double MAX_MISSILE_AGE = 80;
 const double MISSILE_MASS = 25.0;
 const unsigned int MISSILE_SPEED = 7;
 const unsigned int MISSILE_RADIUS = 3;
 
-void Missile::move(double dt)
+Missiles::Missiles()
+    : mHits(0)
+    , mViewX0(0)
+    , mViewY0(0)
+    , mViewX1(Screen::maxX())
+    , mViewY1(Screen::maxY())
+    , mDrawn(0)
 {
-    ScreenObject::move(dt);
+}
 
-    age += dt;
+void Missiles::setView(double x0, double y0, double x1, double y1)
+{
+    // the sprites are drawn a little larger than the missile
+    double margin = MISSILE_RADIUS * 2;
+    mViewX0 = x0 - margin, mViewY0 = y0 - margin;
+    mViewX1 = x1 + margin, mViewY1 = y1 + margin;
+}
 
-    if (age > MAX_MISSILE_AGE) {
-        setState(DEAD);
-    }
+void Missiles::fire(ScreenObject::ObjectType owner,
+                    double rotation,
+                    double x, double y, double z,
+                    double fx, double fy, double fz)
+{
+    mX.push_back(x);
+    mY.push_back(y);
+    mZ.push_back(z);
+    mVX.push_back(fx + sin(rotation) * MISSILE_SPEED);
+    mVY.push_back(fy - cos(rotation) * MISSILE_SPEED);
+    mVZ.push_back(fz);
+    mAge.push_back(0);
+    mOwner.push_back(owner);
+}
+
+void Missiles::clear()
+{
+    mX.clear(), mY.clear(), mZ.clear();
+    mVX.clear(), mVY.clear(), mVZ.clear();
+    mAge.clear();
+    mOwner.clear();
+}
+
+// Order does not matter, so the last missile fills the hole
+
+void Missiles::remove(std::size_t n)
+{
+    std::size_t last = mX.size() - 1;
+
+    mX[n] = mX[last], mY[n] = mY[last], mZ[n] = mZ[last];
+    mVX[n] = mVX[last], mVY[n] = mVY[last], mVZ[n] = mVZ[last];
+    mAge[n] = mAge[last];
+    mOwner[n] = mOwner[last];
+
+    mX.pop_back(), mY.pop_back(), mZ.pop_back();
+    mVX.pop_back(), mVY.pop_back(), mVZ.pop_back();
+    mAge.pop_back();
+    mOwner.pop_back();
 }
 
-Missile::Missile(ObjectType owner,
-                 double rotation,
-                 double x, double y, double z,
-                 double fx, double fy, double fz)
-    : ScreenObject(MISSILE_TYPE, MISSILE_RADIUS, MISSILE_MASS, 100,
-                   x, y, z,
-                   fx + sin(rotation) * MISSILE_SPEED,
-                   fy - cos(rotation) * MISSILE_SPEED, fz)
-    , age(0)
-    , owner_type(owner)
+void Missiles::update(double dt, SpatialIndex& index)
 {
-    switch (owner_type) {
-    case BOGEY_TYPE:
-        r = b = 0;
-        g = 1;
-        break;
-    case PLAYER_TYPE:
-        r = 1;
-        g = b = 0;
-    default:
-        break;
+    std::size_t count = mX.size();
+
+    if (count == 0)
+        return;
+
+    // remember where each missile starts so its path can be swept
+    static std::vector<float> startX, startY;
+    startX.assign(mX.begin(), mX.end());
+    startY.assign(mY.begin(), mY.end());
+
+    // straight line integration over plain arrays; the compiler
+    // vectorizes this loop
+
+    float step = dt;
+    float *x = &mX[0], *y = &mY[0], *z = &mZ[0],
+          *vx = &mVX[0], *vy = &mVY[0], *vz = &mVZ[0],
+          *age = &mAge[0];
+
+    for (std::size_t n = 0; n < count; n++) {
+        x[n] += vx[n] * step;
+        y[n] += vy[n] * step;
+        z[n] += vz[n] * step;
+        age[n] += step;
     }
 
-    setState(ALIVE);
+    // Walk backwards so removing a missile never skips one
+
+    for (std::size_t n = count; n-- > 0;) {
+        if (mAge[n] > MAX_MISSILE_AGE || sweep(n, startX[n], startY[n], index))
+            remove(n);
+    }
 }
 
-Missile::~Missile()
+// Sweeps the missile's path from (x0, y0) over the tick, bouncing it off
+// the walls at the edge of the gameplay area on the way: the path is
+// swept up to the wall it crosses, then what is left of it is reflected
+// and swept from there. Returns true if the missile is spent.
+
+bool Missiles::sweep(std::size_t n, float x0, float y0, SpatialIndex& index)
 {
+    float maxX = Screen::maxX(), maxY = Screen::maxY();
+
+    // one leg per wall, and a missile can cross two at a corner
+    for (int leg = 0; leg < 3; leg++) {
+        float x1 = mX[n], y1 = mY[n];
+        float t = 1;
+        bool xwall = false, ywall = false;
+
+        if (x1 < 0 || x1 > maxX) {
+            float wall = x1 < 0 ? 0 : maxX;
+            t = x1 != x0 ? (wall - x0) / (x1 - x0) : 0;
+            xwall = true;
+        }
+        if (y1 < 0 || y1 > maxY) {
+            float wall = y1 < 0 ? 0 : maxY;
+            float ty = y1 != y0 ? (wall - y0) / (y1 - y0) : 0;
+            if (!xwall || ty < t)
+                t = ty, xwall = false, ywall = true;
+        }
+
+        if (!xwall && !ywall)
+            return sweepSegment(n, x0, y0, x1, y1, index);
+
+        t = std::max(0.f, std::min(1.f, t));
+        float wx = x0 + (x1 - x0) * t, wy = y0 + (y1 - y0) * t;
+
+        if (sweepSegment(n, x0, y0, wx, wy, index))
+            return true;
+
+        if (xwall) {
+            wx = x1 < 0 ? 0 : maxX;
+            mX[n] = 2 * wx - x1, mVX[n] = -mVX[n];
+        } else {
+            wy = y1 < 0 ? 0 : maxY;
+            mY[n] = 2 * wy - y1, mVY[n] = -mVY[n];
+        }
+        x0 = wx, y0 = wy;
+    }
+
+    return false;
 }
 
-bool Missile::collision(ScreenObject& obj) { return true; }
+// Finds the first object the segment from (x0, y0) to (x1, y1) passes
+// within reach of. Returns true if the missile is spent.
+
+bool Missiles::sweepSegment(std::size_t n, float x0, float y0, float x1, float y1,
+                            SpatialIndex& index)
+{
+    float dx = x1 - x0, dy = y1 - y0;
+    ScreenObject::ObjectType owner = mOwner[n];
+
+    ScreenObject* target = 0;
+    double first = 2;
+
+    index.query(std::min(x0, x1) - MISSILE_RADIUS, std::min(y0, y1) - MISSILE_RADIUS,
+                std::max(x0, x1) + MISSILE_RADIUS, std::max(y0, y1) + MISSILE_RADIUS,
+                [&](ScreenObject& obj) {
+                    // no friendly fire
+                    if (obj.type() == owner || !obj.isAlive())
+                        return;
+
+                    double reach = obj.radius + MISSILE_RADIUS;
+                    double ox = x0 - obj.mPosition.x, oy = y0 - obj.mPosition.y;
+
+                    // |o + t d|^2 = reach^2, smallest t in [0, 1]
+                    double a = dx * dx + dy * dy,
+                           b = ox * dx + oy * dy,
+                           c = ox * ox + oy * oy - reach * reach;
+                    double t;
+
+                    if (c <= 0) {
+                        t = 0;
+                    } else if (a == 0 || b >= 0 || b * b - a * c < 0) {
+                        return;
+                    } else {
+                        t = (-b - sqrt(b * b - a * c)) / a;
+                        if (t > 1)
+                            return;
+                    }
+
+                    if (t < first)
+                        first = t, target = &obj;
+                });
 
-const int NUM_AMMO_TYPES = 5;
+    if (!target)
+        return false;
 
-GLuint ammoTex[NUM_AMMO_TYPES];
+    mHits++;
 
-#include "glpng.h"
+    // the target takes the missile's momentum over the next step
+    target->PhysicsObject::accelerate(mVX[n] * MISSILE_MASS, mVY[n] * MISSILE_MASS, 0);
 
-inline void DrawPlayerMissile(Coord3<double>& mPosition, bool player = true)
+    return target->shot(owner);
+}
+
+void Missiles::record(Snapshot& snap)
 {
-    // load textures
+    const int NUM_AMMO_TYPES = 5;
+
+    static SpriteCell ammo[NUM_AMMO_TYPES];
     static bool need_tex = true;
     double radius = MISSILE_RADIUS * 1.5;
     if (need_tex) {
+        AssetManager& assets = AssetManager::getInstance();
         char filename[256];
-        pngInfo tmpInfo;
         for (int i = 0; i < NUM_AMMO_TYPES; ++i) {
-            snprintf(filename, 256, "../data/enemyAmmo%02d.png", i);
-            ammoTex[i] = pngBind(filename, PNG_NOMIPMAPS, PNG_ALPHA,
-                                 &tmpInfo, GL_CLAMP, GL_LINEAR, GL_LINEAR);
-            if (!ammoTex[i]) {
-                fprintf(stderr, "can't load %s\n", filename);
-                abort();
-            }
+            snprintf(filename, 256, "enemyAmmo%02d.png", i);
+            ammo[i] = assets.sprite(assets.find(filename));
         }
         need_tex = false;
     }
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_TEXTURE_2D);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    for (int i = 0; i < NUM_AMMO_TYPES; ++i) {
-        if (player) {
-            glColor4d(1, .5, .2, .7);
-        } else {
-            glColor4d(0, 1, 0, .8);
-        }
-        glBindTexture(GL_TEXTURE_2D, ammoTex[i]);
-        glPushMatrix();
-        glTranslated(mPosition.x, -mPosition.y, mPosition.z);
-        glRotated(rand() % 360, 0, 0, 1);
-        //glRotated((rand() % 4) * 90, 0, 0, 1);
-        glBegin(GL_QUADS);
-        glTexCoord2i(0, 0);
-        glNormal3i(0, 0, 1);
-        glVertex3d(-radius, radius, 0);
-        glTexCoord2i(0, 1);
-        glNormal3i(0, 0, 1);
-        glVertex3d(-radius, -radius, 0);
-        glTexCoord2i(1, 1);
-        glNormal3i(0, 0, 1);
-        glVertex3d(radius, -radius, 0);
-        glTexCoord2i(1, 0);
-        glNormal3i(0, 0, 1);
-        glVertex3d(radius, radius, 0);
-        glEnd();
-        glPopMatrix();
-    }
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_TEXTURE_2D);
-}
 
-void Missile::draw()
-{
-    if (owner_type == PLAYER_TYPE) {
-        DrawPlayerMissile(mPosition);
-    } else {
-        DrawPlayerMissile(mPosition, false);
+    mDrawn = 0;
+
+    SpriteBatch& batch = snap.sprites;
+    for (std::size_t n = 0; n < mX.size(); n++) {
+        if (mX[n] < mViewX0 || mX[n] > mViewX1 || mY[n] < mViewY0 || mY[n] > mViewY1)
+            continue;
+        mDrawn++;
+
+        for (int i = 0; i < NUM_AMMO_TYPES; ++i) {
+            double angle = RAD(rand() % 360);
+            if (mOwner[n] == ScreenObject::PLAYER_TYPE) {
+                batch.add(ammo[i], mX[n], -mY[n], mZ[n],
+                          radius, radius, angle, 1, .5, .2, .7);
+            } else {
+                batch.add(ammo[i], mX[n], -mY[n], mZ[n],
+                          radius, radius, angle, 0, 1, 0, .8);
+            }
+        }
     }
 }
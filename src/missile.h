@@ -13,42 +13,72 @@
 
 #include "object.h"
 
-class Missile : public ScreenObject {
-private:
-    Missile(Missile&);
+#include <vector>
+
+class SpatialIndex;
+struct Snapshot;
 
+// --------------------------------------------------------------------------
+//
+// CLASS: Missiles
+//
+// Every missile in flight, player's and bogeys'. Missiles are too small
+// and short lived to be worth an ODE body each, so they are kept here in
+// flat arrays, one per field, and moved in a single loop over all of
+// them.
+//
+// A missile's path over a tick is swept against the SpatialIndex as a
+// segment, so a fast missile cannot skip over a thin target between two
+// ticks. The first object it touches gets ScreenObject::shot() and a push
+// from the missile's momentum; the missile is spent if the object says
+// so. Missiles bounce off the edge of the gameplay area like everything
+// else; a path that crosses the edge is swept up to it and then on from
+// there after the bounce.
+//
+// --------------------------------------------------------------------------
+
+class Missiles {
 public:
-    double age;
-    ObjectType owner_type;
+    static Missiles& getInstance()
+    {
+        static Missiles instance;
+        return instance;
+    }
 
-    Missile(ObjectType t,
-            double rotation,
-            double x, double y, double z,
-            double fx, double fy, double fz);
-    ~Missile();
+    void fire(ScreenObject::ObjectType owner,
+              double rotation,
+              double x, double y, double z,
+              double fx, double fy, double fz);
 
-    ObjectType ownerType() { return owner_type; }
-    void draw();
-    void move(double dt);
+    void update(double dt, SpatialIndex& index);
+    void clear();
 
-    bool collision(ScreenObject& other);
-};
+    // Only missiles inside the rectangle set by setView() are recorded
+    // into the snapshot's sprite batch
+    void setView(double x0, double y0, double x1, double y1);
+    void record(Snapshot& snap);
 
-class Bomb : public ScreenObject {
-public:
-    double mAge;
-    ObjectType mOwnerType;
+    std::size_t size() { return mX.size(); }
+    std::size_t drawn() { return mDrawn; }
+    unsigned long hits() { return mHits; }
+
+private:
+    Missiles();
 
-    Bomb(ObjectType t,
-         double x, double y, double z,
-         double fx, double fy, double fz);
+    void remove(std::size_t n);
+    bool sweep(std::size_t n, float x0, float y0, SpatialIndex& index);
+    bool sweepSegment(std::size_t n, float x0, float y0, float x1, float y1,
+                      SpatialIndex& index);
 
-    ~Bomb();
+    std::vector<float> mX, mY, mZ;
+    std::vector<float> mVX, mVY, mVZ;
+    std::vector<float> mAge;
+    std::vector<ScreenObject::ObjectType> mOwner;
 
-    void draw();
-    void move(double dt);
+    unsigned long mHits;
 
-    bool collision(ScreenObject& other);
+    float mViewX0, mViewY0, mViewX1, mViewY1;
+    std::size_t mDrawn;
 };
 
 #endif // SSC_MISSILE_H
@@ -9,19 +9,44 @@
 // --------------------------------------------------------------------------
 
 #include "model.h"
+#include "debris.h"
+#include "draw.h"
 #include "font.h"
 #include "game.h"
+#include "gravity.h"
 #include "hud.h"
+#include "missile.h"
+#include "particle.h"
 #include "physics.h"
+#include "quality.h"
+#include "spatial.h"
+
+#include <algorithm>
 
 Environ* mEnviron;
 
 unsigned int numDead = 0;
 extern double mFramerate;
 
+// Objects are culled within this far of the game plane
+const double CULL_SLAB = 200;
+
 Model::Model()
     : mHead(0)
+    , mHaveView(false)
+    , mTick(0)
+    , mFrame(0)
+    , mIdleSpell(0)
+    , mWasIdle(false)
+    , mCapturedSpell(0)
+    , mBackdrop(0)
+    , mBackdropWidth(0)
+    , mBackdropHeight(0)
+    , mCameraTick(0)
 {
+    std::fill(mVisible, mVisible + ScreenObject::NUM_OBJECT_TYPES, 0);
+    std::fill(mTotal, mTotal + ScreenObject::NUM_OBJECT_TYPES, 0);
+
     mWalls.push_back(std::make_shared<Wall>(1, 0, 0, 0));
     mWalls.push_back(std::make_shared<Wall>(0, 1, 0, 0));
     mWalls.push_back(std::make_shared<Wall>(-1, 0, 0, -Screen::maxX()));
@@ -48,89 +73,165 @@ void Model::addObject(ScreenObject* obj)
     obj->next = 0;
 }
 
-struct Particle {
-    Coord3<double> mPosition, mForce;
-    double r, g, b;
-    double time;
-
-    Particle()
-        : mPosition(0, 0, 0)
-        , mForce(0, 0, 0)
-        , r(0)
-        , g(0)
-        , b(0)
-        , time(0)
-    {
-    }
-};
+void Model::update(double dt)
+{
+    Gravity::getInstance().update(mHead);
+    Environ::getInstance().update(dt);
 
-const unsigned int MAXPARTICLES = 30000;
+    SpatialIndex& index = SpatialIndex::getInstance();
+    index.build(mHead);
+    Missiles::getInstance().update(dt, index);
+    Quality& quality = Quality::getInstance();
+    DebrisPool::getInstance().setScale(quality.debrisScale());
+    DebrisPool::getInstance().update(dt);
+    ParticleSystem::getInstance().setScale(quality.particleScale());
+    ParticleSystem::getInstance().update(dt);
 
-Particle mParticles[MAXPARTICLES];
+    Global::audio->setListener(Global::ship->mPosition.x, Global::ship->mPosition.y);
+    Global::audio->update();
 
-unsigned int mParticleId = 0;
+    //
+    // move all screenobjects, removing any dead
+    //
 
-void addParticle(double x, double y, double z,
-                 double fx, double fy, double fz,
-                 double r, double g, double b,
-                 double time)
-{
-    mParticles[mParticleId].mPosition.set(x, y, z);
-    mParticles[mParticleId].mForce.set(fx, fy, fz);
-    mParticles[mParticleId].r = r;
-    mParticles[mParticleId].g = g;
-    mParticles[mParticleId].b = b;
-    mParticles[mParticleId].time = time;
-
-    mParticleId++;
-    if (mParticleId >= MAXPARTICLES) {
-        mParticleId = 0;
+    Global::ship->sync();
+    ScreenObject *i = mHead, *toDelete(0);
+    while (i) {
+        // delete dead objects
+        if (i->isDead()) {
+            toDelete = i;
+
+            // reset the prev/next links
+            if (i->next)
+                i->next->prev = i->prev;
+            if (i->prev)
+                i->prev->next = i->next;
+            else
+                mHead = mHead->next;
+
+            // set i to next value
+            i = toDelete->next;
+
+            delete toDelete;
+            toDelete = 0;
+        } else {
+            // we only move if the object is in a certain state
+            if ((i->isAlive()) || (i->isDying()))
+                i->sync(), i->move(dt);
+
+            // set i to next value
+            i = i->next;
+        }
     }
 }
 
-extern bool mDrawP;
-inline void drawParticles(double dt, bool doMove)
+// Copies the ship, whatever the camera can see, the radar and the menu
+// into snap. While idle, the scene is left out as soon as the renderer
+// has a backdrop of this idle spell.
+
+void Model::record(Snapshot& snap, double dt, bool idle)
 {
-    if (!mDrawP) {
+    if (idle && !mWasIdle) {
+        mIdleSpell++;
+    }
+    mWasIdle = idle;
+
+    snap.clear();
+    snap.tick = ++mTick;
+    snap.dt = dt;
+    snap.quality = Quality::getInstance().level();
+    snap.idle = idle;
+    snap.idleSpell = mIdleSpell;
+    snap.scene = !idle || mCapturedSpell != mIdleSpell;
+
+    Game& game = Game::getInstance();
+
+    if (game.getMode() == Game::MENU) {
+        game.recordMenu(snap.menu);
+    }
+
+    if (!snap.scene) {
         return;
     }
-    Coord3<double> pos;
-    Particle *p, *lp;
 
-    lp = &mParticles[MAXPARTICLES];
+    Ship& ship = *Global::ship;
+    snap.ship.x = ship.mPosition.x;
+    snap.ship.y = ship.mPosition.y;
+    snap.ship.rotation = ship.rotation;
+    snap.ship.speed = ship.speed;
+    snap.ship.shield = ship.shield.getStrength();
+    snap.ship.life = ship.mLife;
 
-    draw::startPoints();
-    for (p = mParticles; p < lp; p++) {
-        if (p->time > 0) {
-            if (doMove) {
-                p->time -= dt;
-                p->mPosition += (p->mForce * dt);
-            }
-            pos.set(p->mPosition);
-            draw::setColor(p->r, p->g, p->b);
-            draw::point((int)pos.x, (int)pos.y, (int)pos.z);
+    ParticleSystem::getInstance().record(snap);
+
+    cull();
+
+    std::fill(mVisible, mVisible + ScreenObject::NUM_OBJECT_TYPES, 0);
+    std::fill(mTotal, mTotal + ScreenObject::NUM_OBJECT_TYPES, 0);
+
+    for (ScreenObject* i = mHead; i; i = i->next) {
+        mTotal[i->type()]++;
+        if (i->mDrawFrame == mFrame) {
+            mVisible[i->type()]++;
+            i->record(snap);
+        }
+        if (i->isAlive()) {
+            Snapshot::Blip blip = { (float)i->mPosition.x, (float)i->mPosition.y, i->r, i->g, i->b };
+            snap.blips.push_back(blip);
         }
     }
-    draw::endPoints();
+
+    Missiles& missiles = Missiles::getInstance();
+    missiles.record(snap);
+    mVisible[ScreenObject::MISSILE_TYPE] = missiles.drawn();
+    mTotal[ScreenObject::MISSILE_TYPE] = missiles.size();
+
+    DebrisPool::getInstance().record(snap);
 }
 
-inline void Model::draw(double dt, bool doMove)
+void Model::render(const Snapshot& snap)
 {
+    // meshes dropped by the simulation since the last frame
+    Snapshot::collectMeshes();
+
     draw::clearScreen();
+
+    if (snap.scene) {
+        drawScene(snap);
+        if (snap.idle) {
+            captureBackdrop();
+            mCapturedSpell = snap.idleSpell;
+        }
+    } else {
+        drawBackdrop();
+    }
+
+    if (snap.menu.shown) {
+        GameMenu::draw(snap.menu);
+    }
+}
+
+void Model::drawScene(const Snapshot& snap)
+{
     glPushMatrix();
 
     //
     // point camera in right direction
     //
 
-    double x = (Global::ship->mPosition.x),
-           y = -(Global::ship->mPosition.y);
-
     static Coord3<double> shipPos;
 
-    shipPos.set(x, y, 0);
-    mCamera.setTarget(shipPos, Global::ship->rotation, Global::ship->speed);
-    mCamera.update(dt);
+    shipPos.set(snap.ship.x, -snap.ship.y, 0);
+    mCamera.setTarget(shipPos, snap.ship.rotation, snap.ship.speed);
+
+    // a snapshot drawn again (an expose, or the radar toggled) has had
+    // its time already
+    mCamera.update(snap.tick != mCameraTick ? snap.dt : 0);
+    mCameraTick = snap.tick;
+
+    Frustum frustum;
+    mCamera.frustum(frustum);
+    setView(frustum);
 
     //
     // draw the stars
@@ -150,69 +251,129 @@ inline void Model::draw(double dt, bool doMove)
     draw::line(bx, by + extra, bx, ay - extra);
     draw::line(bx + extra, ay, ax - extra, ay);
 
+    snap.drawParticles();
+
     //
-    // Call the particle engine draw method
+    // draw the objects, then the debris of the ones exploding
     //
 
-    drawParticles(dt, doMove);
+    for (std::size_t n = 0; n < snap.items.size(); n++) {
+        const Snapshot::Item& item = snap.items[n];
+        item.render(item);
+    }
+    snap.drawDebris();
 
     //
-    // draw all screenobjects, removing any dead
+    // draw the additive sprites queued by the objects in one pass
     //
 
-    Global::ship->sync();
-    ScreenObject *i = mHead, *toDelete(0);
-    while (i) {
-        // delete dead objects
-        if (i->isDead()) {
-            toDelete = i;
+    snap.sprites.draw();
 
-            // reset the prev/next links
-            if (i->next)
-                i->next->prev = i->prev;
-            if (i->prev)
-                i->prev->next = i->next;
-            else
-                mHead = mHead->next;
+    //
+    // draw the HUD (Heads-Up-Display)
+    //
 
-            // set i to next value
-            i = toDelete->next;
+    HUD::getInstance().draw(snap);
 
-            delete toDelete;
-            toDelete = 0;
-        } else {
-            // we only move if we're not paused and the object is
-            // in a certain state
-            if (doMove && ((i->isAlive()) || (i->isDying())))
-                i->sync(), i->move(dt);
+    glPopMatrix();
+}
 
-            // ...but we always draw
-            i->draw();
+// Copies the frame drawn so far into the backdrop texture, which is made
+// the first time at the next power of two up from the display
 
-            // set i to next value
-            i = i->next;
+void Model::captureBackdrop()
+{
+    int w = Screen::mDisplay.x, h = Screen::mDisplay.y;
+
+    if (!mBackdrop) {
+        for (mBackdropWidth = 1; mBackdropWidth < w; mBackdropWidth <<= 1) {
+        }
+        for (mBackdropHeight = 1; mBackdropHeight < h; mBackdropHeight <<= 1) {
         }
+
+        glGenTextures(1, &mBackdrop);
+        glBindTexture(GL_TEXTURE_2D, mBackdrop);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mBackdropWidth, mBackdropHeight, 0,
+                     GL_RGB, GL_UNSIGNED_BYTE, 0);
     }
 
-    //
-    // draw the HUD (Heads-Up-Display)
-    //
+    glBindTexture(GL_TEXTURE_2D, mBackdrop);
+    glReadBuffer(GL_BACK);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, w, h);
+}
 
-    HUD::getInstance().draw();
+void Model::drawBackdrop()
+{
+    if (!mBackdrop) {
+        return;
+    }
 
-    Game& game = Game::getInstance();
+    int w = Screen::mDisplay.x, h = Screen::mDisplay.y;
 
-    if (game.getMode() == Game::MENU) {
-        game.drawMenu();
-    }
+    draw::setMode(draw::DRAW_2D);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, mBackdrop);
+    draw::setColor(1, 1, 1);
 
-    glPopMatrix();
-    draw::flipBuffers();
+    // the copy has the bottom row first
+    draw::texturedBox(0, h, w, 0, w / (float)mBackdropWidth, h / (float)mBackdropHeight);
+
+    glDisable(GL_TEXTURE_2D);
+    draw::setMode(draw::DRAW_3D);
 }
 
-void Model::setPlayerPos()
+void Model::setView(const Frustum& frustum)
 {
-    HUD::getInstance().update(Global::ship);
+    std::lock_guard<std::mutex> lock(mViewLock);
+    mView = frustum;
+    mHaveView = true;
+}
+
+// Stamps every object in the renderer's last view frustum with the
+// current frame. The live objects are found through the spatial index,
+// rebuilt here since the list has just changed; the debris of dying ones
+// is culled piece by piece in the DebrisPool. Until the renderer has
+// drawn a frame, everything is recorded.
+
+void Model::cull()
+{
+    mFrame++;
+
+    Frustum frustum;
+    bool haveView;
+    {
+        std::lock_guard<std::mutex> lock(mViewLock);
+        frustum = mView;
+        haveView = mHaveView;
+    }
+
+    SpatialIndex& index = SpatialIndex::getInstance();
+    index.build(mHead);
+
+    // the frustum is in GL coordinates, where game y is negated
+    double x0, y0, x1, y1;
+    if (!haveView) {
+        for (ScreenObject* i = mHead; i; i = i->next)
+            i->mDrawFrame = mFrame;
+
+        Missiles::getInstance().setView(0, 0, Screen::maxX(), Screen::maxY());
+        DebrisPool::getInstance().setView(0, 0, Screen::maxX(), Screen::maxY());
+    } else if (frustum.bounds(-CULL_SLAB, CULL_SLAB, &x0, &y0, &x1, &y1)) {
+        index.query(x0, -y1, x1, -y0, [&](ScreenObject& obj) {
+            if (frustum.sphere(obj.mPosition.x, -obj.mPosition.y, obj.mPosition.z, obj.radius))
+                obj.mDrawFrame = mFrame;
+        });
+
+        Missiles::getInstance().setView(x0, -y1, x1, -y0);
+        DebrisPool::getInstance().setView(x0, -y1, x1, -y0);
+    } else {
+        Missiles::getInstance().setView(0, 0, -1, -1);
+        DebrisPool::getInstance().setView(0, 0, -1, -1);
+    }
 }
 
 void Model::startGame() { clearLevel(true); }
@@ -247,14 +408,9 @@ void Model::clearLevel(bool reset)
             i = i->next;
         }
     }
+    Missiles::getInstance().clear();
+    DebrisPool::getInstance().clear();
     if (reset) {
         Global::ship->init();
     }
 }
-
-void Model::update(double dt, bool doMove)
-{
-    Environ::getInstance().update(dt);
-    draw(dt, doMove);
-    //draw::checkErrors();
-}
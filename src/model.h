@@ -14,10 +14,30 @@
 #include "camera.h"
 #include "flock.h"
 #include "object.h"
+#include "snapshot.h"
 #include "starfield.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
+// --------------------------------------------------------------------------
+//
+// CLASS: Model
+//
+// The list of objects in play. update() and record() belong to the
+// simulation: they step the world and copy what can be seen into a
+// Snapshot. render() belongs to the renderer, which owns the GL context,
+// the camera and the star field, and draws a snapshot without looking at
+// any object. The renderer hands the camera's frustum back through
+// setView() for the next record() to cull against.
+//
+// While the game is idle nothing in the scene changes, so the renderer
+// copies the first idle frame into a texture and from then on draws only
+// that and the menu over it.
+//
+// --------------------------------------------------------------------------
+
 class Model {
 private:
     Model();
@@ -30,25 +50,57 @@ public:
     }
 
     void addObject(ScreenObject* obj);
-    void draw(double dt, bool doMove = true);
-    void update(double dt, bool doMove = true);
-    void setPlayerPos();
     void clearLevel(bool reset = false);
     void startGame();
 
+    // simulation thread
+    void update(double dt);
+    void record(Snapshot& snap, double dt, bool idle);
+
+    // render thread; the caller flips the buffers
+    void render(const Snapshot& snap);
     void cycleCameraView() { mCamera.cycle(); }
+
     inline ScreenObject* getHead() { return mHead; }
 
+    // objects of a type recorded and in existence, as of the last snapshot
+    unsigned int visible(ScreenObject::ObjectType t) { return mVisible[t]; }
+    unsigned int total(ScreenObject::ObjectType t) { return mTotal[t]; }
+
 private:
+    void cull();
+    void setView(const Frustum& frustum);
+
+    void drawScene(const Snapshot& snap);
+    void captureBackdrop();
+    void drawBackdrop();
+
     ScreenObject* mHead;
     StarField mStarField;
     Camera mCamera;
     std::vector<std::shared_ptr<Wall>> mWalls;
-};
 
-void addParticle(double x, double y, double z,
-                 double fx, double fy, double fz,
-                 double r = 1, double g = 1, double b = 1,
-                 double time = 20);
+    // the renderer's last frustum, for cull()
+    std::mutex mViewLock;
+    Frustum mView;
+    bool mHaveView;
+
+    unsigned long mTick;
+    unsigned int mFrame;
+
+    // idle spells begun, and the last one the renderer has a backdrop of
+    unsigned int mIdleSpell;
+    bool mWasIdle;
+    std::atomic<unsigned int> mCapturedSpell;
+
+    // written by record(), for the stats
+    unsigned int mVisible[ScreenObject::NUM_OBJECT_TYPES];
+    unsigned int mTotal[ScreenObject::NUM_OBJECT_TYPES];
+
+    // render thread
+    unsigned int mBackdrop;
+    int mBackdropWidth, mBackdropHeight;
+    unsigned long mCameraTick; // snapshot the camera last moved for
+};
 
 #endif // SSC_MODEL_H
@@ -29,6 +29,7 @@ ScreenObject::ScreenObject(ObjectType t,
     , mFlocking(false)
     , mGravity(false)
     , mGravityAffect(0, 0)
+    , mDrawFrame(0)
     , mType(t)
     , mState(CREATE)
     , mMaxSpeed(ms)
@@ -37,6 +38,7 @@ ScreenObject::ScreenObject(ObjectType t,
     , mDecelFlag(false)
 {
     Model::getInstance().addObject(this);
+    updateCategory();
     reset();
 }
 
@@ -73,12 +75,15 @@ void ScreenObject::decelerate(double dt)
 
 void ScreenObject::move(double dt)
 {
-    double amt = mass * mVelocity.z * dt * .1;
-    if (mVelocity.z < 0) {
-        PhysicsObject::accelerate(0.0, 0.0, -amt);
-    }
-    if (mVelocity.z > 0) {
-        PhysicsObject::accelerate(0.0, 0.0, amt);
+    // a planar body never picks up any z velocity to damp
+    if (!planar()) {
+        double amt = mass * mVelocity.z * dt * .1;
+        if (mVelocity.z < 0) {
+            PhysicsObject::accelerate(0.0, 0.0, -amt);
+        }
+        if (mVelocity.z > 0) {
+            PhysicsObject::accelerate(0.0, 0.0, amt);
+        }
     }
     if (speed > mMaxSpeed) {
         decelerate(dt);
@@ -101,3 +106,36 @@ void ScreenObject::reset()
 {
     mGravityAffect.set(0, 0);
 }
+
+void ScreenObject::updateCategory()
+{
+    CollisionCategory c = CATEGORY_NONE;
+
+    switch (mType) {
+    case PLAYER_TYPE:
+        c = CATEGORY_PLAYER;
+        break;
+    case MISSILE_TYPE:
+        break;
+    case BOGEY_TYPE:
+        c = CATEGORY_BOGEY;
+        break;
+    case FATSO_TYPE:
+        c = CATEGORY_FATSO;
+        break;
+    case LUNATIC_TYPE:
+        c = CATEGORY_LUNATIC;
+        break;
+    case BLACKHOLE_TYPE:
+        c = CATEGORY_BLACKHOLE;
+        break;
+    case ASTEROID_TYPE:
+        c = CATEGORY_ASTEROID;
+        break;
+    case SMARTY_TYPE:
+        c = CATEGORY_SMARTY;
+        break;
+    }
+
+    setCategory(c);
+}
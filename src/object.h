@@ -14,6 +14,8 @@
 #include "physics.h"
 #include "screen.h"
 
+struct Snapshot;
+
 // --------------------------------------------------------------------------
 //
 // CLASS: ScreenObject
@@ -38,6 +40,7 @@ public:
     friend class Model;
     friend class Flock;
     friend class HUD;
+    friend class Gravity;
 
     enum ObjectType {
         PLAYER_TYPE,
@@ -50,6 +53,8 @@ public:
         SMARTY_TYPE
     };
 
+    static const int NUM_OBJECT_TYPES = SMARTY_TYPE + 1;
+
     enum ObjectState {
         CREATE,
         ALIVE,
@@ -139,6 +144,9 @@ protected:
     bool mGravity;
     Coord2<double> mGravityAffect;
 
+    // the last frame Model found this object in view
+    unsigned int mDrawFrame;
+
 protected:
     ObjectType mType;
     ObjectState mState;
@@ -153,6 +161,9 @@ public:
 
     virtual void reset();
 
+    // place the geometry in the collision matrix by type
+    void updateCategory();
+
 public:
     inline bool shouldCollide(Collidable* other)
     {
@@ -181,7 +192,30 @@ public:
         return true;
     }
 
+    // collision() only decides whether obj should bounce this object; it
+    // runs inside the collide phase and must not change any state.
+    // collided() is where touching obj has its consequences, once the
+    // world has been stepped.
+
     virtual bool collision(ScreenObject& obj) = 0;
+    virtual void collided(ScreenObject&, const CollisionEvent&) {}
+
+    // Hit by a missile fired by owner (see Missiles). Returns whether
+    // the missile is stopped; by default everything is solid.
+    virtual bool shot(ObjectType) { return true; }
+
+    inline void react(Collidable* other, const CollisionEvent& e)
+    {
+        // an earlier event of the same dispatch may have killed us
+        if (!isAlive())
+            return;
+
+        const CollisionData* data = other->collisionData();
+
+        if (data->type == COLLISION_SCREENOBJECT) {
+            collided(*((ScreenObject*)(data->ptr)), e);
+        }
+    }
 
     // ------------------------------------------------------------------
     //
@@ -189,7 +223,9 @@ public:
     //
     // ------------------------------------------------------------------
 
-    virtual void draw() = 0;
+    // Copies what the renderer needs to draw this object into snap. This
+    // runs on the simulation thread; nothing here may touch GL.
+    virtual void record(Snapshot& snap) = 0;
 
     ScreenObject *next, *prev;
     bool mDecelFlag;
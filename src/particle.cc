@@ -0,0 +1,200 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "particle.h"
+#include "common.h"
+#include "object.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+const std::size_t MAXPARTICLES = 30000;
+
+// random values per particle field, see spawn()
+const uint32_t FIELDS = 8;
+
+extern bool mDrawP;
+
+// engine flame, sprayed back in a 30 degree cone from the hull
+static const Emitter THRUSTER = {
+    3, (float)RAD(30), .5,
+    { 1, 1 }, { 0, .8f }, { 0, .3f },
+    { 0, 24 },
+    5.5f
+};
+
+ParticleSystem::ParticleSystem()
+    : mX(MAXPARTICLES)
+    , mY(MAXPARTICLES)
+    , mZ(MAXPARTICLES)
+    , mVX(MAXPARTICLES)
+    , mVY(MAXPARTICLES)
+    , mVZ(MAXPARTICLES)
+    , mR(MAXPARTICLES)
+    , mG(MAXPARTICLES)
+    , mB(MAXPARTICLES)
+    , mTime(MAXPARTICLES)
+    , mNext(0)
+    , mUsed(0)
+    , mLongest(0)
+    , mScale(1)
+    , mSeed(rand())
+    , mBurstCount(0)
+    , mSpawned(0)
+{
+    mThruster = addEmitter(THRUSTER);
+}
+
+ParticleSystem::EmitterId ParticleSystem::addEmitter(const Emitter& emitter)
+{
+    mEmitters.push_back(emitter);
+    return (EmitterId)(mEmitters.size() - 1);
+}
+
+void ParticleSystem::setScale(float scale)
+{
+    mScale = scale < 0 ? 0 : scale;
+}
+
+void ParticleSystem::emit(EmitterId id, const ScreenObject& owner, double speed, double lift)
+{
+    if (!mDrawP) {
+        return;
+    }
+
+    const Emitter& e = mEmitters[id];
+    Burst burst;
+    burst.emitter = id;
+    burst.x = owner.mPosition.x - owner.radius * sin(owner.rotation);
+    burst.y = owner.mPosition.y + owner.radius * cos(owner.rotation);
+    burst.z = owner.mPosition.z;
+    burst.rotation = owner.rotation;
+    burst.speed = speed * e.speed;
+    burst.lift = lift * e.speed;
+    mBursts.push_back(burst);
+}
+
+// A stateless hash of a counter, so every random value of a burst can be
+// worked out independently of the others rather than in rand() order.
+
+static inline uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// in [0, 1)
+static inline float unit(uint32_t x)
+{
+    return (hash(x) >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float mix(const float range[2], float t)
+{
+    return range[0] + (range[1] - range[0]) * t;
+}
+
+void ParticleSystem::spawn()
+{
+    if (mBursts.empty()) {
+        return;
+    }
+    mBurstCount += mBursts.size();
+
+    // first how many each burst gets, uniform in [0, 2 * rate]
+    mBurstOf.clear();
+    for (unsigned int n = 0; n < mBursts.size(); n++) {
+        float most = 2 * mEmitters[mBursts[n].emitter].rate * mScale;
+        unsigned int count = (unsigned int)(unit(mSeed++) * (most + 1));
+        mBurstOf.insert(mBurstOf.end(), count, n);
+    }
+
+    std::size_t total = mBurstOf.size();
+    if (total > MAXPARTICLES) {
+        total = MAXPARTICLES;
+    }
+
+    // then every new particle of the frame in a single loop
+    for (std::size_t i = 0; i < total; i++) {
+        const Burst& b = mBursts[mBurstOf[i]];
+        const Emitter& e = mEmitters[b.emitter];
+        uint32_t s = mSeed + (uint32_t)i * FIELDS;
+
+        float p = e.spread * (2 * unit(s) - 1);
+        float a = b.rotation + p;
+        std::size_t slot = mNext;
+
+        mX[slot] = b.x + e.jitter * (2 * unit(s + 1) - 1);
+        mY[slot] = b.y + e.jitter * (2 * unit(s + 2) - 1);
+        mZ[slot] = b.z + e.jitter * (2 * unit(s + 3) - 1);
+        mVX[slot] = -sinf(a) * b.speed;
+        mVY[slot] = cosf(a) * b.speed;
+        mVZ[slot] = sinf(p) * b.lift;
+        mR[slot] = mix(e.r, unit(s + 4));
+        mG[slot] = mix(e.g, unit(s + 5));
+        mB[slot] = mix(e.b, unit(s + 6));
+        mTime[slot] = mix(e.life, unit(s + 7));
+        mLongest = std::max(mLongest, mTime[slot]);
+
+        if (++mNext == MAXPARTICLES) {
+            mNext = 0;
+        }
+    }
+
+    mUsed = std::min(MAXPARTICLES, mUsed + total);
+    mSeed += (uint32_t)total * FIELDS;
+    mSpawned += total;
+    mBursts.clear();
+}
+
+void ParticleSystem::update(double dt)
+{
+    spawn();
+
+    if (mLongest <= 0) {
+        return;
+    }
+
+    // every slot in use, live or not, so the loop has no branch and
+    // vectorizes; a spent particle only drifts further below zero time
+    float step = dt;
+    mLongest -= step;
+    float *x = &mX[0], *y = &mY[0], *z = &mZ[0],
+          *vx = &mVX[0], *vy = &mVY[0], *vz = &mVZ[0],
+          *time = &mTime[0];
+
+    for (std::size_t n = 0; n < mUsed; n++) {
+        x[n] += vx[n] * step;
+        y[n] += vy[n] * step;
+        z[n] += vz[n] * step;
+        time[n] -= step;
+    }
+}
+
+void ParticleSystem::record(Snapshot& snap)
+{
+    if (!mDrawP || mLongest <= 0) {
+        return;
+    }
+    for (std::size_t n = 0; n < mUsed; n++) {
+        if (mTime[n] > 0) {
+            Snapshot::Point point;
+            point.x = mX[n], point.y = mY[n], point.z = mZ[n];
+            point.r = mR[n], point.g = mG[n], point.b = mB[n];
+            snap.particles.push_back(point);
+        }
+    }
+}
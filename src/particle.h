@@ -0,0 +1,120 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_PARTICLE_H
+#define SSC_PARTICLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ScreenObject;
+struct Snapshot;
+
+// --------------------------------------------------------------------------
+//
+// CLASS: Emitter
+//
+// How a source of particles sprays them: from the back edge of its owner,
+// into a cone opening backwards, with colour and lifetime picked from a
+// range for each particle.
+//
+// --------------------------------------------------------------------------
+
+struct Emitter {
+    float jitter; // start points are scattered this far either way
+    float spread; // half angle of the cone, radians
+    float speed; // fraction of the speed given to emit() they leave at
+    float r[2], g[2], b[2]; // colour ranges, low and high
+    float life[2];
+    float rate; // particles per burst on average, before scaling
+};
+
+// --------------------------------------------------------------------------
+//
+// CLASS: ParticleSystem
+//
+// The thruster exhaust of everything in play. Entities register an
+// Emitter once and then only ask for a burst from it each time they
+// thrust; the bursts are queued and all of them are spawned together at
+// the start of update(), in one pass over the new particles. The
+// particles live in a ring of flat arrays, one per field, the oldest
+// being overwritten when it is full.
+//
+// setScale() multiplies every burst, so what the particles cost can be
+// traded away in one place.
+//
+// --------------------------------------------------------------------------
+
+class ParticleSystem {
+public:
+    typedef unsigned int EmitterId;
+
+    static ParticleSystem& getInstance()
+    {
+        static ParticleSystem instance;
+        return instance;
+    }
+
+    EmitterId addEmitter(const Emitter& emitter);
+
+    // the engine flame every ship, bogey and smarty thrusts with
+    EmitterId thruster() { return mThruster; }
+
+    // A burst from the emitter of owner, moving at speed. lift is the
+    // speed the cone's tilt turns into vertical motion.
+    void emit(EmitterId id, const ScreenObject& owner, double speed, double lift);
+
+    void update(double dt);
+    void record(Snapshot& snap);
+
+    void setScale(float scale);
+    float scale() { return mScale; }
+
+    // since the last resetStats()
+    unsigned long bursts() { return mBurstCount; }
+    unsigned long spawned() { return mSpawned; }
+    void resetStats() { mBurstCount = mSpawned = 0; }
+
+private:
+    ParticleSystem();
+
+    struct Burst {
+        EmitterId emitter;
+        float x, y, z; // where the cone starts
+        float rotation, speed, lift;
+    };
+
+    void spawn();
+
+    std::vector<Emitter> mEmitters;
+    EmitterId mThruster;
+    std::vector<Burst> mBursts;
+    std::vector<unsigned int> mBurstOf; // for each new particle
+
+    std::vector<float> mX, mY, mZ;
+    std::vector<float> mVX, mVY, mVZ;
+    std::vector<float> mR, mG, mB;
+    std::vector<float> mTime; // left to live
+    std::size_t mNext;
+
+    // Slots ever written, and how long the longest lived particle has
+    // left; with particles off nothing is spawned and update() and
+    // record() do no work at all.
+    std::size_t mUsed;
+    float mLongest;
+
+    float mScale;
+    uint32_t mSeed;
+
+    unsigned long mBurstCount, mSpawned;
+};
+
+#endif // SSC_PARTICLE_H
@@ -1,8 +1,10 @@
 #include "physics.h"
+#include "config.h"
 
-//! Defines the maximum number of contact points we will consider
-
-const unsigned int MAX_CONTACTS = 5;
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 
 void NearCallback(void* data, dGeomID g1, dGeomID g2)
 {
@@ -21,6 +23,8 @@ void NearCallback(void* data, dGeomID g1, dGeomID g2)
     //
     // ----------------------------------------------------------------
 
+    environ.mNearPairs++;
+
     // get the body information associated with each geometry
     dBodyID b1 = dGeomGetBody(g1), b2 = dGeomGetBody(g2);
 
@@ -67,10 +71,16 @@ void NearCallback(void* data, dGeomID g1, dGeomID g2)
     bounce_a = (ca ? (ca->shouldCollide(cb)) : true);
     bounce_b = (cb ? (cb->shouldCollide(ca)) : true);
 
-    // if there is no bouncing to be done then bailout
+    // if there is no bouncing to be done, we only need the contact when
+    // both sides are screen objects which may still react to touching
+
+    bool screen_objects = a && b && a->type == COLLISION_SCREENOBJECT
+        && b->type == COLLISION_SCREENOBJECT;
 
     if (!bounce_a && !bounce_b) {
-        return;
+        environ.mDeclinedPairs++;
+        if (!screen_objects)
+            return;
     }
 
     // ----------------------------------------------------------------
@@ -90,9 +100,7 @@ void NearCallback(void* data, dGeomID g1, dGeomID g2)
     // dCollide will find all the contact points between the two
     // objects if they exists
 
-    numContacts = dCollide(g1, g2, MAX_CONTACTS,
-                           &contact[0].geom,
-                           sizeof(dContact));
+    numContacts = environ.collide(g1, g2, contact);
 
     // bail out if there aren't any contacts
 
@@ -106,6 +114,34 @@ void NearCallback(void* data, dGeomID g1, dGeomID g2)
     //
     // ----------------------------------------------------------------
 
+    // record the pair; the game reacts to it after the step
+
+    int feedback = -1;
+
+    if (screen_objects) {
+        CollisionEvent e;
+        e.a = ca, e.b = cb;
+        e.contact = contact[0].geom;
+        for (i = 1; i < numContacts; ++i) {
+            if (contact[i].geom.depth > e.contact.depth)
+                e.contact = contact[i].geom;
+        }
+        e.impulse = 0;
+        e.feedback = -1;
+        e.joints = 0;
+
+        if (bounce_a || bounce_b) {
+            feedback = environ.mFeedbackJoints.size();
+            e.feedback = feedback;
+            e.joints = numContacts;
+        }
+        environ.mEvents.push_back(e);
+    }
+
+    if (!bounce_a && !bounce_b) {
+        return;
+    }
+
     // for each contact, create a contact joint (this is what
     // performs the collision response in the next dWorldStep
 
@@ -116,10 +152,417 @@ void NearCallback(void* data, dGeomID g1, dGeomID g2)
 
         if (bounce_a && bounce_b) {
             dJointAttach(c, b1, b2);
+            if (i == 0 && b1 && b2)
+                environ.mContacts.push_back(std::make_pair(b1, b2));
         } else if (bounce_a) {
             dJointAttach(c, b1, 0);
         } else {
             dJointAttach(c, 0, b2);
         }
+
+        if (feedback >= 0) {
+            environ.mFeedbackJoints.push_back(c);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+//
+// Memory
+//
+// ---------------------------------------------------------------------------
+
+// Every ODE allocation passes through these hooks. They only count; the
+// memory still comes from malloc. The counters are atomic because the
+// step threads allocate too.
+
+static std::atomic<unsigned long> odeAllocs(0), odeBytes(0);
+
+static void* odeAlloc(size_t size)
+{
+    odeAllocs++;
+    odeBytes += size;
+    return malloc(size);
+}
+
+static void* odeRealloc(void* ptr, size_t oldsize, size_t newsize)
+{
+    odeAllocs++;
+    odeBytes += newsize;
+    odeBytes -= oldsize;
+    return realloc(ptr, newsize);
+}
+
+static void odeFree(void* ptr, size_t size)
+{
+    odeBytes -= size;
+    free(ptr);
+}
+
+// dWorldStep lays its working memory out in an arena of its own, which
+// it rewinds at the start of every step; the reservation policy below
+// keeps the arena's blocks between steps rather than freeing them. The
+// blocks come through these, so the log shows how much is held and how
+// often it had to grow.
+
+static std::atomic<unsigned long> stepAllocs(0), stepBytes(0), stepBlocks(0);
+
+static void* stepAlloc(size_t size)
+{
+    stepAllocs++;
+    stepBytes += size;
+    stepBlocks++;
+    return odeAlloc(size);
+}
+
+static void* stepShrink(void* block, size_t size, size_t smaller)
+{
+    stepBytes -= size - smaller;
+    return odeRealloc(block, size, smaller);
+}
+
+static void stepFree(void* block, size_t size)
+{
+    stepBytes -= size;
+    stepBlocks--;
+    odeFree(block, size);
+}
+
+bool Environ::planarFromConfig()
+{
+    return Config::getInstance().planarPhysics();
+}
+
+void Environ::installMemoryHooks()
+{
+    dSetAllocHandler(odeAlloc);
+    dSetReallocHandler(odeRealloc);
+    dSetFreeHandler(odeFree);
+}
+
+// Keep the step's memory between steps, with some room to spare, so a
+// steady scene never has to reallocate it.
+
+void Environ::setStepMemory()
+{
+    dWorldStepReserveInfo reserve;
+    reserve.struct_size = sizeof(reserve);
+    reserve.reserve_factor = 1.2f;
+    reserve.reserve_minimum = 64 * 1024;
+    dWorldSetStepMemoryReservationPolicy(mWorld, &reserve);
+
+    dWorldStepMemoryFunctionsInfo memory;
+    memory.struct_size = sizeof(memory);
+    memory.alloc_block = stepAlloc;
+    memory.shrink_block = stepShrink;
+    memory.free_block = stepFree;
+    dWorldSetStepMemoryManager(mWorld, &memory);
+}
+
+unsigned long Environ::heapAllocs() { return odeAllocs; }
+unsigned long Environ::heapBytes() { return odeBytes; }
+unsigned long Environ::stepMemoryAllocs() { return stepAllocs; }
+unsigned long Environ::stepMemoryBytes() { return stepBytes; }
+unsigned long Environ::stepMemoryBlocks() { return stepBlocks; }
+
+// ---------------------------------------------------------------------------
+//
+// Threads
+//
+// ---------------------------------------------------------------------------
+
+void Environ::startThreads()
+{
+    unsigned int threads = Config::getInstance().physicsThreads();
+
+    if (threads <= 1)
+        return;
+
+    mThreading = dThreadingAllocateMultiThreadedImplementation();
+    mThreadPool = dThreadingAllocateThreadPool(threads, 0, dAllocateFlagBasicData, 0);
+
+    if (!mThreading || !mThreadPool) {
+        fprintf(stderr, "Could not start %u physics threads; stepping on one\n", threads);
+        if (mThreadPool)
+            dThreadingFreeThreadPool(mThreadPool), mThreadPool = 0;
+        if (mThreading)
+            dThreadingFreeImplementation(mThreading), mThreading = 0;
+        return;
+    }
+
+    dThreadingThreadPoolServeMultiThreadedImplementation(mThreadPool, mThreading);
+    dWorldSetStepThreadingImplementation(mWorld,
+                                         dThreadingImplementationGetFunctions(mThreading),
+                                         mThreading);
+    dWorldSetStepIslandsProcessingMaxThreadCount(mWorld, threads);
+    mThreads = threads;
+}
+
+Environ::~Environ()
+{
+    if (mThreading) {
+        dThreadingImplementationShutdownProcessing(mThreading);
+        dThreadingThreadPoolWaitIdleState(mThreadPool);
+        dWorldSetStepThreadingImplementation(mWorld, 0, 0);
+        dThreadingFreeThreadPool(mThreadPool);
+        dThreadingFreeImplementation(mThreading);
+    }
+}
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+// ---------------------------------------------------------------------------
+//
+// Contact cache
+//
+// ---------------------------------------------------------------------------
+
+static inline int bodyIndex(dBodyID b)
+{
+    return (int)(intptr_t)dBodyGetData(b);
+}
+
+// Only pairs of bodies are cached, and only when one of them has a shape
+// that is costly to test; walls are planes, which have no position to
+// compare, and the test against them is cheap anyway.
+
+static inline bool costly(dGeomID g)
+{
+    int c = dGeomGetClass(g);
+    return c == dConvexClass || c == dTriMeshClass || c == dHeightfieldClass;
+}
+
+// The slot for the pair (a, b) in the table written in the given tick.
+// With claim set, a slot not yet used this tick is taken for the pair;
+// otherwise only an entry already written for it is returned.
+
+Environ::CachedContacts* Environ::cachedContacts(unsigned long tick, int a, int b, bool claim)
+{
+    std::vector<CachedContacts>& table = mContactCache[tick & 1];
+    if (table.empty())
+        return 0;
+
+    std::size_t mask = table.size() - 1;
+    std::size_t slot = ((std::size_t)a * 73856093u ^ (std::size_t)b * 19349663u) & mask;
+
+    for (std::size_t probe = 0; probe <= mask; probe++, slot = (slot + 1) & mask) {
+        CachedContacts& entry = table[slot];
+
+        if (entry.tick != tick) {
+            if (!claim)
+                return 0;
+            entry.a = a, entry.b = b;
+            entry.tick = tick;
+            mCacheEntries++;
+            return &entry;
+        }
+        if (entry.a == a && entry.b == b)
+            return &entry;
+    }
+    return 0;
+}
+
+unsigned int Environ::collide(dGeomID g1, dGeomID g2, dContact* contact)
+{
+    dBodyID b1 = dGeomGetBody(g1), b2 = dGeomGetBody(g2);
+
+    if (!b1 || !b2 || !(costly(g1) || costly(g2))) {
+        return dCollide(g1, g2, MAX_CONTACTS, &contact[0].geom, sizeof(dContact));
+    }
+
+    int a = bodyIndex(b1), b = bodyIndex(b2);
+    unsigned long ga = mBodyGeneration[a], gb = mBodyGeneration[b];
+
+    const dReal *p1 = dGeomGetPosition(g1), *p2 = dGeomGetPosition(g2);
+    dReal rel[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+
+    // the table may be full, in which case the pair is not kept
+    const CachedContacts* last = cachedContacts(mTick - 1, a, b, false);
+    bool full = mCacheEntries * 2 >= mContactCache[mTick & 1].size();
+    CachedContacts* next = full ? 0 : cachedContacts(mTick, a, b, true);
+    if (full)
+        mCacheWanted = mContactCache[mTick & 1].size() * 2;
+
+    if (last && last->ga == ga && last->gb == gb) {
+        dReal dx = rel[0] - last->rel[0], dy = rel[1] - last->rel[1],
+              dz = rel[2] - last->rel[2];
+
+        if (dx * dx + dy * dy + dz * dz < CONTACT_CACHE_TOLERANCE * CONTACT_CACHE_TOLERANCE) {
+            mCacheHits++;
+
+            // the pair moved as one; carry its contacts along with g1
+            dReal mx = p1[0] - last->p1[0], my = p1[1] - last->p1[1],
+                  mz = p1[2] - last->p1[2];
+
+            for (unsigned int i = 0; i < last->count; i++) {
+                dContactGeom& geom = contact[i].geom;
+                geom = last->contacts[i];
+                geom.pos[0] += mx, geom.pos[1] += my, geom.pos[2] += mz;
+            }
+
+            // kept as they were computed, so drift cannot build up
+            if (next)
+                *next = *last, next->tick = mTick;
+            return last->count;
+        }
+    }
+
+    mCacheMisses++;
+
+    unsigned int count = dCollide(g1, g2, MAX_CONTACTS, &contact[0].geom, sizeof(dContact));
+
+    if (next) {
+        next->ga = ga, next->gb = gb;
+        for (int k = 0; k < 3; k++)
+            next->p1[k] = p1[k], next->rel[k] = rel[k];
+        for (unsigned int i = 0; i < count; i++)
+            next->contacts[i] = contact[i].geom;
+        next->count = count;
+    }
+
+    return count;
+}
+
+void Environ::update(double dt)
+{
+    unsigned long allocs = odeAllocs;
+
+    mStepSize = dt;
+    mNearPairs = mDeclinedPairs = 0;
+    mEvents.clear();
+    mFeedbackJoints.clear();
+    mContacts.clear();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mTick++;
+
+    // the table written this tick held the pairs of two ticks ago, none
+    // of which count any more, so it can be regrown freely
+    std::vector<CachedContacts>& table = mContactCache[mTick & 1];
+    if (table.size() < mCacheWanted)
+        table.assign(mCacheWanted, CachedContacts());
+    mCacheEntries = 0;
+
+    dSpaceCollide(mSpace, 0, NearCallback);
+
+    // the feedback only has its final size now, so the joints are given
+    // their slots once it can no longer move
+    mFeedback.resize(mFeedbackJoints.size());
+    for (std::size_t f = 0; f < mFeedbackJoints.size(); f++)
+        dJointSetFeedback(mFeedbackJoints[f], &mFeedback[f]);
+    mCollideTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+    //dWorldStepFast1(mWorld, dt, 5);
+    dWorldStep(mWorld, dt); // , 5)
+    mStepTime = elapsed(start);
+
+    dJointGroupEmpty(mContactGroup);
+
+    mStepHeapAllocs = odeAllocs - allocs;
+
+    countIslands();
+    dispatch();
+}
+
+// ---------------------------------------------------------------------------
+//
+// Islands
+//
+// ---------------------------------------------------------------------------
+
+// The per-body arrays only grow here, as the body count reaches a new high,
+// never during a step.
+
+dBodyID Environ::newBody()
+{
+    int index;
+
+    if (!mFreeBodies.empty()) {
+        index = mFreeBodies.back();
+        mFreeBodies.pop_back();
+    } else {
+        index = mIslandParent.size();
+        mIslandParent.push_back(index);
+        mIslandStamp.push_back(0);
+        mBodyGeneration.push_back(0);
+    }
+
+    dBodyID b = dBodyCreate(mWorld);
+    dBodySetData(b, (void*)(intptr_t)index);
+    return b;
+}
+
+void Environ::destroyBody(dBodyID b)
+{
+    int index = bodyIndex(b);
+    mBodyGeneration[index]++;
+    mFreeBodies.push_back(index);
+    dBodyDestroy(b);
+}
+
+int Environ::findIsland(int body)
+{
+    int root = body;
+    while (mIslandParent[root] != root)
+        root = mIslandParent[root];
+    while (mIslandParent[body] != root) {
+        int next = mIslandParent[body];
+        mIslandParent[body] = root;
+        body = next;
+    }
+    return root;
+}
+
+// Union-find over the bodies joined by two-sided contacts. Bodies held
+// only by one-sided joints or walls step on their own, so they are not
+// counted. Every body starts as an island of its own, and every join of
+// two islands leaves one fewer.
+
+void Environ::countIslands()
+{
+    mIslands = 0;
+
+    for (std::size_t n = 0; n < mContacts.size(); n++) {
+        int a = bodyIndex(mContacts[n].first), b = bodyIndex(mContacts[n].second);
+
+        if (mIslandStamp[a] != mTick)
+            mIslandStamp[a] = mTick, mIslandParent[a] = a, mIslands++;
+        if (mIslandStamp[b] != mTick)
+            mIslandStamp[b] = mTick, mIslandParent[b] = b, mIslands++;
+
+        int ra = findIsland(a), rb = findIsland(b);
+        if (ra != rb)
+            mIslandParent[ra] = rb, mIslands--;
+    }
+}
+
+// Sum the force each event's joints applied over the step, then let both
+// objects react. The first feedback slot always belongs to the attached
+// body when a joint is one-sided, so f1 alone gives the magnitude.
+// Contacts are only created between objects that are alive, and nothing
+// is deleted until the model's next pass, so the pointers recorded
+// during the collide phase are still valid here.
+
+void Environ::dispatch()
+{
+    for (std::size_t n = 0; n < mEvents.size(); n++) {
+        CollisionEvent& e = mEvents[n];
+
+        if (e.feedback >= 0) {
+            dReal fx = 0, fy = 0, fz = 0;
+            for (int f = e.feedback; f < e.feedback + e.joints; f++) {
+                const dJointFeedback& fb = mFeedback[f];
+                fx += fb.f1[0], fy += fb.f1[1], fz += fb.f1[2];
+            }
+            e.impulse = sqrt(fx * fx + fy * fy + fz * fz) * mStepSize;
+        }
+
+        e.a->react(e.b, e);
+        e.b->react(e.a, e);
     }
 }
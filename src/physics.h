@@ -5,6 +5,8 @@
 #include "ode/ode.h"
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 //! The ERP specifies what proportion of the joint error will be fixed during
 //! the next simulation step. If ERP=0 then no correcting force is applied and
@@ -22,6 +24,19 @@ const dReal ERP = 0.8;
 
 const dReal CFM = 0.000001;
 
+//! Defines the maximum number of contact points we will consider
+
+const unsigned int MAX_CONTACTS = 5;
+
+//! Two bodies whose relative position has moved less than this since
+//! their contacts were last computed reuse those contacts.
+
+const dReal CONTACT_CACHE_TOLERANCE = 0.05;
+
+//! Slots in each contact cache table to begin with; a power of two.
+
+const std::size_t CONTACT_CACHE_INITIAL = 256;
+
 //! Prototype for NearCallback (implemented in physics.cc). This function is
 //! called whenever two geometries are close enough to each other.
 
@@ -29,7 +44,91 @@ extern void NearCallback(void* data, dGeomID g1, dGeomID g2);
 
 // ---------------------------------------------------------------------------
 //
-//! \class Environ
+//! \enum CollisionCategory
+//
+//! Every geometry is put in one category, which becomes its ODE category
+//! bit. Missiles are not ODE geometries; see Missiles.
+//
+// ---------------------------------------------------------------------------
+
+enum CollisionCategory {
+    CATEGORY_WALL,
+    CATEGORY_RAY,
+    CATEGORY_PLAYER,
+    CATEGORY_BOGEY,
+    CATEGORY_FATSO,
+    CATEGORY_LUNATIC,
+    CATEGORY_BLACKHOLE,
+    CATEGORY_ASTEROID,
+    CATEGORY_SMARTY,
+    CATEGORY_NONE, //!< not yet classified; collides with everything
+    NUM_CATEGORIES
+};
+
+//! Pairs of categories which can never interact. ODE tests the category
+//! and collide bits before the bounding boxes, so these pairs are dropped
+//! inside dSpaceCollide and never reach NearCallback or the virtual
+//! shouldCollide().
+
+struct CollisionPair {
+    CollisionCategory a, b;
+};
+
+constexpr CollisionPair CULLED_PAIRS[] = {
+    // rays only look at screen objects, and only at other kinds
+    { CATEGORY_RAY, CATEGORY_RAY },
+    { CATEGORY_RAY, CATEGORY_WALL },
+
+    // blackholes only pull, and asteroids drift through each other
+    { CATEGORY_BLACKHOLE, CATEGORY_BLACKHOLE },
+    { CATEGORY_BLACKHOLE, CATEGORY_WALL },
+    { CATEGORY_ASTEROID, CATEGORY_ASTEROID },
+};
+
+constexpr unsigned long categoryBit(CollisionCategory c)
+{
+    return c == CATEGORY_NONE ? ~0ul : 1ul << c;
+}
+
+//! The ODE collide bits for category c: everything except the categories
+//! it is paired with in CULLED_PAIRS.
+
+constexpr unsigned long collideBits(CollisionCategory c)
+{
+    unsigned long bits = ~0ul;
+    for (const CollisionPair& p : CULLED_PAIRS) {
+        if (p.a == c)
+            bits &= ~categoryBit(p.b);
+        if (p.b == c)
+            bits &= ~categoryBit(p.a);
+    }
+    return bits;
+}
+
+static_assert(!(collideBits(CATEGORY_ASTEROID) & categoryBit(CATEGORY_ASTEROID)),
+              "collision matrix is not evaluated at compile time");
+
+class Collidable;
+
+// ---------------------------------------------------------------------------
+//
+//! \struct CollisionEvent
+//
+//! A touching pair found during dSpaceCollide. NearCallback only records
+//! these; the game reacts to them (damage, explosions, sounds) once the
+//! world has been stepped, so nothing in the collide phase has side
+//! effects beyond the contact joints.
+//
+// ---------------------------------------------------------------------------
+
+struct CollisionEvent {
+    Collidable *a, *b;
+    dContactGeom contact; //!< the deepest contact point, normal from a to b
+    dReal impulse; //!< contact impulse during the step; 0 if it passed through
+    int feedback; //!< first of its joints' feedback, -1 if no joints
+    int joints; //!< number of contact joints created for the pair
+};
+
 //
 //! The environment class is responsible for containing the ODE word and space,
 //! as well as the contact group for handling collisions. Its responsibilities
@@ -60,6 +159,106 @@ private:
 
     //@}
 
+    //! \name Broadphase Statistics
+
+    //@{
+    //! Geometries per category, and the pairs seen by NearCallback in the
+    //! last step. A declined pair reached the callback but neither side
+    //! wanted the contact; a frequent one belongs in CULLED_PAIRS.
+
+    unsigned long mPopulation[NUM_CATEGORIES];
+    unsigned long mNearPairs, mDeclinedPairs;
+
+    //@}
+
+    //! \name Deferred Collision Events
+
+    //@{
+    //! Events recorded during the current step, and the joint feedback
+    //! their impulses are read from. The joints that want feedback are
+    //! collected during the collide phase and pointed at mFeedback only
+    //! once it has stopped growing. Like the other per-step vectors these
+    //! are cleared, not freed, so they stay at their high-water mark.
+
+    std::vector<CollisionEvent> mEvents;
+    std::vector<dJointID> mFeedbackJoints;
+    std::vector<dJointFeedback> mFeedback;
+    double mStepSize;
+
+    //@}
+
+    //! \name Threaded Stepping
+
+    //@{
+    //! With [physics] threads > 1 the world owns an ODE multi-threaded
+    //! implementation served by a pool of that many threads, and
+    //! dWorldStep processes independent islands in parallel. mContacts
+    //! holds the body pairs joined during the collide phase, which is all
+    //! that is needed to count the islands.
+    //!
+    //! Each body carries a small index as its ODE data, handed out by
+    //! newBody() and reused after destroyBody(). The island union-find
+    //! runs over flat arrays by that index; an entry is only valid if its
+    //! stamp is the current tick, so nothing is cleared between ticks.
+
+    dThreadingImplementationID mThreading;
+    dThreadingThreadPoolID mThreadPool;
+    unsigned int mThreads;
+
+    std::vector<std::pair<dBodyID, dBodyID>> mContacts;
+    std::vector<int> mFreeBodies;
+    std::vector<int> mIslandParent;
+    std::vector<unsigned long> mIslandStamp;
+    unsigned long mIslands;
+    double mCollideTime, mStepTime;
+
+    //@}
+
+    //! Heap allocations ODE made during the last update.
+
+    unsigned long mStepHeapAllocs;
+
+    //! Whether bodies are held to the z = 0 plane; see PhysicsObject.
+
+    bool mPlanar;
+
+    //! \name Contact Cache
+
+    //@{
+    //! Contacts between two bodies, from the last tick the pair was near.
+    //! When the pair has hardly moved relative to itself the cached
+    //! contacts are moved along with the first geom instead of running
+    //! dCollide again. That only pays for geoms whose test is expensive;
+    //! spheres, boxes and planes are always collided directly.
+    //!
+    //! Two open-addressed tables keyed on the body indices: last tick's
+    //! is read, this tick's written, and they swap every tick. An entry
+    //! only counts if its tick matches, so neither is ever cleared. A
+    //! body's generation changes when it is destroyed, so a new body that
+    //! reuses the index never picks up the old one's contacts. A table
+    //! that fills up stops caching for the rest of the tick and is grown
+    //! before it is next written.
+
+    struct CachedContacts {
+        int a, b; //!< body indices of g1 and g2
+        unsigned long ga, gb; //!< and their generations
+        unsigned long tick; //!< the tick the entry was written in
+        dVector3 p1, rel; //!< position of g1 and of g2 relative to it
+        dContactGeom contacts[MAX_CONTACTS];
+        unsigned int count;
+    };
+
+    std::vector<CachedContacts> mContactCache[2];
+    std::size_t mCacheEntries, mCacheWanted;
+    std::vector<unsigned long> mBodyGeneration;
+    unsigned long mTick;
+    unsigned long mCacheHits, mCacheMisses;
+
+    unsigned int collide(dGeomID g1, dGeomID g2, dContact* contact);
+    CachedContacts* cachedContacts(unsigned long tick, int a, int b, bool claim);
+
+    //@}
+
     //! static instance
 
     //! private constructor
@@ -68,7 +267,28 @@ private:
         : mWorld(0)
         , mSpace(0)
         , mContactGroup(0)
+        , mNearPairs(0)
+        , mDeclinedPairs(0)
+        , mStepSize(0)
+        , mThreading(0)
+        , mThreadPool(0)
+        , mThreads(1)
+        , mIslands(0)
+        , mCollideTime(0)
+        , mStepTime(0)
+        , mStepHeapAllocs(0)
+        , mPlanar(false)
+        , mCacheEntries(0)
+        , mCacheWanted(CONTACT_CACHE_INITIAL)
+        , mTick(0)
+        , mCacheHits(0)
+        , mCacheMisses(0)
     {
+        std::fill(mPopulation, mPopulation + NUM_CATEGORIES, 0);
+
+        // before anything is created, so every ODE allocation is counted
+        installMemoryHooks();
+
         mWorld = dWorldCreate();
 
         // there is a QuadTree space available in ODE, but I couldn't
@@ -89,8 +309,21 @@ private:
 
         dWorldSetERP(mWorld, ERP);
         dWorldSetCFM(mWorld, CFM);
+
+        setStepMemory();
+        startThreads();
+
+        mPlanar = planarFromConfig();
     }
 
+    bool planarFromConfig();
+
+    void installMemoryHooks();
+    void setStepMemory();
+    void startThreads();
+    void countIslands();
+    int findIsland(int body);
+
 public:
     //! there can be only one world at a time; this method takes the place
     //! of the constructor.
@@ -101,13 +334,16 @@ public:
         return instance;
     }
 
+    ~Environ();
+
     //! \name Factory Methods
 
     //@{
     //! The following methods are factory methods for creating ODE
     //! bodies and geometries of different shapes
 
-    inline dBodyID newBody() { return dBodyCreate(mWorld); }
+    dBodyID newBody();
+    void destroyBody(dBodyID b);
     inline dGeomID newSphere(double r) { return dCreateSphere(0, r); }
     inline dGeomID newPlane(double a, double b, double c, double d)
     {
@@ -120,6 +356,15 @@ public:
     {
         return dJointCreateHinge(mWorld, group);
     }
+    inline dJointID newPlane2D() { return dJointCreatePlane2D(mWorld, 0); }
+
+    //! In planar mode every body is constrained to the z = 0 plane, with
+    //! rotation only about z. The plane-2D joint adds three constraint
+    //! rows per body to the step, so this is off unless [physics] planar
+    //! is set; compare the physics step time in the log before turning
+    //! it on.
+
+    inline bool planar() { return mPlanar; }
 
     //@}
 
@@ -139,6 +384,39 @@ public:
 
     inline void setSpace(dGeomID g) { dSpaceAdd(mSpace, g); }
 
+    //! Keeps the per category population up to date as geometries are
+    //! classified and destroyed.
+
+    inline void moveCategory(CollisionCategory from, CollisionCategory to)
+    {
+        mPopulation[from]--;
+        mPopulation[to]++;
+    }
+    inline void addCategory(CollisionCategory c) { mPopulation[c]++; }
+    inline void removeCategory(CollisionCategory c) { mPopulation[c]--; }
+
+    //! \name Broadphase Statistics
+
+    //@{
+    //! ODE does not report the pairs it drops on the category bits, so
+    //! maskedPairs() counts the candidate pairs the matrix rules out from
+    //! the population of each category.
+
+    unsigned long nearPairs() { return mNearPairs; }
+    unsigned long declinedPairs() { return mDeclinedPairs; }
+
+    unsigned long maskedPairs()
+    {
+        unsigned long masked = 0;
+        for (const CollisionPair& p : CULLED_PAIRS) {
+            unsigned long n = mPopulation[p.a], m = mPopulation[p.b];
+            masked += p.a == p.b ? n * (n > 0 ? n - 1 : 0) / 2 : n * m;
+        }
+        return masked;
+    }
+
+    //@}
+
     //! Collision detection
 
     //! This is the main timestep function; it is called once per
@@ -146,24 +424,81 @@ public:
     //! the process is:
     //!
     //!     - check for all overlapping objects (and calculate
-    //!       response by adding contact joints)
+    //!       response by adding contact joints), recording a
+    //!       CollisionEvent for each touching pair
     //!
     //!     - step the world by timestep dt
     //!
     //!     - clear the contact joints, and repeat forever
     //!
+    //! After the step, the recorded events are handed to both objects'
+    //! react() in one batch.
+    //!
     //! Notably, we are calling dWorldStepFast1() with 5 iterations. This
     //! is *much* faster than the regular dWorldStep(), but sacrifices
     //! accuracy. I've not had any accuracy problems, and it is not likely
     //! important in a game like SSC.
 
-    inline void update(double dt)
+    void update(double dt);
+
+    //! The timestep of the current (or last) update, for reactions which
+    //! scale with time.
+
+    inline double stepSize() { return mStepSize; }
+
+    //! Number of events dispatched by the last update.
+
+    inline unsigned long events() { return mEvents.size(); }
+
+    //! \name Step Statistics
+
+    //@{
+    //! Threads the world steps with, contact islands (groups of two or
+    //! more bodies joined by contacts) in the last step, and the time in
+    //! milliseconds spent colliding and stepping.
+
+    inline unsigned int threads() { return mThreads; }
+    inline unsigned long islands() { return mIslands; }
+    inline double collideTime() { return mCollideTime; }
+    inline double stepTime() { return mStepTime; }
+
+    //@}
+
+    //! \name Memory Statistics
+
+    //@{
+    //! All ODE allocations go through counting hooks. dWorldStep's
+    //! working memory is kept between steps (see physics.cc), so once it
+    //! and the contact group have grown to fit the scene, stepHeapAllocs()
+    //! should stay at zero. Only ODE is counted; the game's own per-step
+    //! vectors keep their capacity but are not tracked here.
+
+    inline unsigned long stepHeapAllocs() { return mStepHeapAllocs; }
+
+    //! \name Contact Cache Statistics
+
+    //@{
+
+    inline std::size_t contactCacheSize() { return mCacheEntries; }
+    inline double contactCacheHitRate()
     {
-        dSpaceCollide(mSpace, 0, NearCallback);
-        //dWorldStepFast1(mWorld, dt, 5);
-        dWorldStep(mWorld, dt); // , 5)
-        dJointGroupEmpty(mContactGroup);
+        unsigned long total = mCacheHits + mCacheMisses;
+        return total ? (double)mCacheHits / total : 0;
     }
+    inline void resetContactCacheStats() { mCacheHits = mCacheMisses = 0; }
+
+    //@}
+
+    unsigned long heapAllocs();
+    unsigned long heapBytes();
+    unsigned long stepMemoryAllocs();
+    unsigned long stepMemoryBytes();
+    unsigned long stepMemoryBlocks();
+
+    //@}
+
+private:
+    void dispatch();
 };
 
 // ---------------------------------------------------------------------------
@@ -224,15 +559,34 @@ class Collidable {
 protected:
     dGeomID mGeometry;
     CollisionData mCollData;
+    CollisionCategory mCategory;
 
 public:
     Coord3<double> mPosition;
     Collidable()
         : mGeometry(0)
+        , mCategory(CATEGORY_NONE)
+    {
+        Environ::getInstance().addCategory(mCategory);
+    }
+
+    virtual ~Collidable()
     {
+        Environ& environ = Environ::getInstance();
+        environ.removeCategory(mCategory);
+        dGeomDestroy(mGeometry);
     }
 
-    virtual ~Collidable() { dGeomDestroy(mGeometry); }
+    //! Places the geometry in category c and sets its ODE bits from the
+    //! collision matrix. Must be called after mGeometry is created.
+
+    void setCategory(CollisionCategory c)
+    {
+        Environ::getInstance().moveCategory(mCategory, c);
+        mCategory = c;
+        dGeomSetCategoryBits(mGeometry, categoryBit(c));
+        dGeomSetCollideBits(mGeometry, collideBits(c));
+    }
 
     inline const CollisionData* collisionData() { return &mCollData; }
 
@@ -250,6 +604,11 @@ public:
     }
 
     inline virtual bool shouldCollide(Collidable* other) { return true; }
+
+    //! Called after the world step for every event this object took part
+    //! in. This is where collisions may change game state.
+
+    inline virtual void react(Collidable* other, const CollisionEvent& e) {}
 };
 
 // ---------------------------------------------------------------------------
@@ -270,6 +629,7 @@ public:
         mGeometry = environ.newPlane(a, b, c, d);
         environ.setSpace(mGeometry);
         dGeomSetData(mGeometry, 0);
+        setCategory(CATEGORY_WALL);
     }
 
     virtual ~Wall() {}
@@ -301,6 +661,7 @@ public:
         mGeometry = environ.newSphere(radius);
         setData(COLLISION_RAY, (void*)mParent);
         environ.setSpace(mGeometry);
+        setCategory(CATEGORY_RAY);
     }
     virtual ~Ray() { mParent = 0; }
 
@@ -340,6 +701,7 @@ public:
 class PhysicsObject : public Collidable {
 private:
     dBodyID mBody;
+    dJointID mPlane;
 
 public:
     Coord3<double> mVelocity;
@@ -351,13 +713,20 @@ public:
                   double x, double y, double z,
                   double fx, double fy, double fz,
                   void* data)
-        : mVelocity(fx, fy, fz)
+        : mPlane(0)
+        , mVelocity(fx, fy, fz)
         , mass(_mass)
         , radius(r)
         , speed(hypot(fx, fy))
     {
         Environ& environ = Environ::getInstance();
 
+        // everything is drawn from x and y alone in planar mode
+        if (environ.planar()) {
+            z = fz = 0;
+            mVelocity.z = 0;
+        }
+
         // set all body params
         mBody = environ.newBody();
         dBodySetForce(mBody, fx, fy, fz);
@@ -385,13 +754,22 @@ public:
 
         // set physical position
         setPosition(x, y, z);
+
+        if (environ.planar()) {
+            mPlane = environ.newPlane2D();
+            dJointAttach(mPlane, mBody, 0);
+        }
     }
 
     virtual ~PhysicsObject()
     {
-        dBodyDestroy(mBody);
+        if (mPlane)
+            dJointDestroy(mPlane);
+        Environ::getInstance().destroyBody(mBody);
     }
 
+    inline bool planar() { return mPlane != 0; }
+
     //! \name setPosition and setVelocity
 
     //@{
@@ -444,9 +822,15 @@ public:
         const dReal *pos = dGeomGetPosition(mGeometry),
                     *vel = dBodyGetLinearVel(mBody);
 
-        mPosition.set(pos[0], pos[1], pos[2]);
-        mVelocity.set(vel[0], vel[1], vel[2]);
-        speed = mVelocity.length();
+        if (mPlane) {
+            mPosition.set(pos[0], pos[1], 0);
+            mVelocity.set(vel[0], vel[1], 0);
+            speed = hypot(vel[0], vel[1]);
+        } else {
+            mPosition.set(pos[0], pos[1], pos[2]);
+            mVelocity.set(vel[0], vel[1], vel[2]);
+            speed = mVelocity.length();
+        }
     }
 
     //! acceleration is achieved by adding x, y, and z forces to the
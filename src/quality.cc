@@ -0,0 +1,126 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "quality.h"
+#include "config.h"
+
+#include <SDL/SDL.h>
+#include <algorithm>
+#include <cstdio>
+
+const unsigned int WINDOW_MS = 1000;
+
+// at least this many frames before a window counts
+const std::size_t MIN_SAMPLES = 10;
+
+// windows in a row before the level moves
+const unsigned int SLOW_WINDOWS = 2;
+const unsigned int FAST_WINDOWS = 5;
+
+// below this fraction of the budget a window is fast
+const double HEADROOM = .7;
+
+// by level, lowest first
+static const float PARTICLE_SCALE[Quality::MAX_LEVEL + 1] = { .1f, .25f, .5f, .75f, 1 };
+static const float DEBRIS_SCALE[Quality::MAX_LEVEL + 1] = { .25f, .4f, .6f, .8f, 1 };
+static const float SPHERE_DETAIL[Quality::MAX_LEVEL + 1] = { .4f, .55f, .7f, .85f, 1 };
+static const unsigned int RADAR_INTERVAL[Quality::MAX_LEVEL + 1] = { 4, 3, 2, 1, 1 };
+static const unsigned int AI_INTERVAL[Quality::MAX_LEVEL + 1] = { 8, 4, 4, 2, 1 };
+
+Quality::Quality()
+    : mBudget(Config::getInstance().frameBudget())
+    , mShared(false)
+    , mLevel(MAX_LEVEL)
+    , mWindowStart(0)
+    , mOver(0)
+    , mUnder(0)
+    , mFrameTime(0)
+    , mTickTime(0)
+{
+}
+
+float Quality::particleScale() { return PARTICLE_SCALE[level()]; }
+float Quality::debrisScale() { return DEBRIS_SCALE[level()]; }
+float Quality::sphereDetail() { return SPHERE_DETAIL[level()]; }
+unsigned int Quality::radarInterval() { return RADAR_INTERVAL[level()]; }
+unsigned int Quality::aiInterval() { return AI_INTERVAL[level()]; }
+
+void Quality::tick(double ms)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTicks.push_back(ms);
+}
+
+// Windows are closed by the renderer, which draws at least once a tick
+// when busy, and in single threaded mode once a tick exactly
+
+void Quality::frame(double ms)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFrames.push_back(ms);
+
+    unsigned int now = SDL_GetTicks();
+    if (mWindowStart == 0) {
+        mWindowStart = now;
+    }
+    if (now - mWindowStart < WINDOW_MS) {
+        return;
+    }
+    if (mFrames.size() >= MIN_SAMPLES) {
+        govern();
+    }
+    mFrames.clear();
+    mTicks.clear();
+    mWindowStart = now;
+}
+
+static double percentile90(std::vector<float>& samples)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    std::vector<float>::iterator nth = samples.begin() + samples.size() * 9 / 10;
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+void Quality::govern()
+{
+    double frameTime = percentile90(mFrames), tickTime = percentile90(mTicks);
+    mFrameTime = frameTime, mTickTime = tickTime;
+
+    if (mBudget <= 0) {
+        return;
+    }
+
+    double load = mShared ? frameTime + tickTime : std::max(frameTime, tickTime);
+
+    if (load > mBudget) {
+        mOver++, mUnder = 0;
+    } else if (load < mBudget * HEADROOM) {
+        mUnder++, mOver = 0;
+    } else {
+        mOver = mUnder = 0;
+    }
+
+    int level = mLevel, old = level;
+    if (mOver >= SLOW_WINDOWS && level > 0) {
+        level--;
+    } else if (mUnder >= FAST_WINDOWS && level < MAX_LEVEL) {
+        level++;
+    }
+
+    if (level != old) {
+        mLevel = level;
+        mOver = mUnder = 0;
+        fprintf(stderr, "quality: level %d -> %d (frame %.2f ms, tick %.2f ms, budget %.1f ms)\n",
+                old, level, frameTime, tickTime, mBudget);
+    }
+}
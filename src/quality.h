@@ -0,0 +1,87 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_QUALITY_H
+#define SSC_QUALITY_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: Quality
+//
+// Trades detail for frame time. The renderer reports how long each frame
+// took to draw and the simulation how long each tick took to compute;
+// once a second the 90th percentile of each is held against [video]
+// frame_budget. Two slow windows in a row drop the level by one, five
+// fast ones raise it again, so a single hitch or a brief lull does not
+// make the detail flicker.
+//
+// Times are wall clock around the work, with no GPU timer queries, so
+// the governor works the same on the software renderers we run on. A
+// frame is timed up to glFinish() and not through the buffer flip, so
+// waiting for vsync is not counted against the budget.
+//
+// The level is read from both threads; everything below is derived from
+// it alone.
+//
+// --------------------------------------------------------------------------
+
+class Quality {
+public:
+    static const int MAX_LEVEL = 4;
+
+    static Quality& getInstance()
+    {
+        static Quality instance;
+        return instance;
+    }
+
+    // Set when the simulation and the renderer run on one thread, so
+    // their times add up to the frame rather than overlap.
+    void setShared(bool shared) { mShared = shared; }
+
+    // milliseconds of work, idle frames and ticks excepted
+    void frame(double ms);
+    void tick(double ms);
+
+    int level() { return mLevel; }
+
+    // the knobs
+    float particleScale();
+    float debrisScale();
+    float sphereDetail();
+    bool coarseAsteroids() { return level() < 2; }
+    unsigned int radarInterval(); // times the [video] radar_rate period
+    unsigned int aiInterval(); // ticks between off-screen AI updates
+
+    // as of the last window
+    double frameTime() { return mFrameTime; }
+    double tickTime() { return mTickTime; }
+
+private:
+    Quality();
+
+    void govern();
+
+    double mBudget;
+    bool mShared;
+    std::atomic<int> mLevel;
+
+    std::mutex mMutex;
+    std::vector<float> mFrames, mTicks;
+    unsigned int mWindowStart;
+    unsigned int mOver, mUnder;
+    std::atomic<double> mFrameTime, mTickTime;
+};
+
+#endif // SSC_QUALITY_H
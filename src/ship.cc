@@ -9,10 +9,13 @@
 // --------------------------------------------------------------------------
 
 #include "ship.h"
+#include "asset.h"
 #include "draw.h"
 #include "global.h"
-#include "glpng.h"
 #include "model.h"
+#include "particle.h"
+#include "snapshot.h"
+#include "sprite.h"
 
 const unsigned int SHIP_SHIELD_RADIUS = 12;
 const unsigned int SHIP_MAX_SPEED = 15;
@@ -26,21 +29,13 @@ inline void calcRotationPoints(double* x, double* y, double rot, int radius)
     *y = rint(-cos(rot) * radius);
 }
 
-int SPHERE;
-GLuint ammoFlash1;
+int SPHERE = -1;
+SpriteCell ammoFlash1;
 
-Ship::Ship(double x, double y)
-    : ScreenObject(PLAYER_TYPE,
-                   SHIP_SHIELD_RADIUS,
-                   SHIP_MASS,
-                   SHIP_MAX_SPEED,
-                   x, y)
-{
-    r = g = 1;
-    b = 0;
-
-    init();
+// Builds the ship's display list the first time the renderer needs it
 
+static void buildSphere()
+{
     /* make a display list containing a sphere */
     SPHERE = glGenLists(1);
     glNewList(SPHERE, GL_COMPILE);
@@ -53,7 +48,7 @@ Ship::Ship(double x, double y)
     // ship body
     glPushMatrix();
     glScalef(1, 1, .5);
-    gluSphere(quad, radius, 20, 20);
+    gluSphere(quad, SHIP_SHIELD_RADIUS, 20, 20);
     glPopMatrix();
 
     // thrust cylinder 1
@@ -101,13 +96,22 @@ Ship::Ship(double x, double y)
     gluDeleteQuadric(quad);
 
     glEndList();
+}
 
-    pngInfo tmpInfo;
-    ammoFlash1 = pngBind("../data/heroAmmoFlash00.png", PNG_NOMIPMAPS, PNG_ALPHA, &tmpInfo, GL_CLAMP, GL_LINEAR, GL_LINEAR);
-    if (!ammoFlash1) {
-        fprintf(stderr, "can't load ammoflash\n");
-        abort();
-    }
+Ship::Ship(double x, double y)
+    : ScreenObject(PLAYER_TYPE,
+                   SHIP_SHIELD_RADIUS,
+                   SHIP_MASS,
+                   SHIP_MAX_SPEED,
+                   x, y)
+{
+    r = g = 1;
+    b = 0;
+
+    init();
+
+    AssetManager& assets = AssetManager::getInstance();
+    ammoFlash1 = assets.sprite(assets.find("heroAmmoFlash00.png")).flipV();
 }
 
 Ship::~Ship()
@@ -171,80 +175,41 @@ void Ship::move(double dt)
     ScreenObject::move(dt);
 }
 
-inline void drawQuad(double szx, double szy)
+static void render(const Snapshot::Item& item)
 {
-    glBegin(GL_TRIANGLE_STRIP);
-    glTexCoord2i(1, 1);
-    glNormal3d(0, 0, 1);
-    glVertex3d(szx, szy, 0);
-    glTexCoord2i(0, 1);
-    glNormal3d(0, 0, 1);
-    glVertex3d(-szx, szy, 0);
-    glTexCoord2i(1, 0);
-    glNormal3d(0, 0, 1);
-    glVertex3d(szx, -szy, 0);
-    glTexCoord2i(0, 0);
-    glNormal3d(0, 0, 1);
-    glVertex3d(-szx, -szy, 0);
-    glEnd();
+    if (SPHERE == -1) {
+        buildSphere();
+    }
+
+    draw::setColor(.4, .3, .2, item.a);
+
+    glPushMatrix();
+    glTranslated(item.x, -item.y, item.z);
+    glRotated(DEG(-item.rotation) + 90, 0, 0, 1);
+    glCallList(SPHERE);
+    glPopMatrix();
 }
 
-void Ship::draw()
+void Ship::record(Snapshot& snap)
 {
     if (getState() == ALIVE) {
         if (accelFlag) {
-            double c1f = 1 - .65,
-                   c2f = -(1 - .65),
-                   c1[4] = { 0.85, 0.65, 1.00, 0.7 },
-                   c2[4] = { 1.00, 0.20, 0.25, 0.7 },
-                   esz = 1.0 + c2f;
-
-            glPushMatrix();
-
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-            glColor4d(c1[0] * c1f + c2[0] * c2f,
-                      c1[1] * c1f + c2[1] * c2f,
-                      c1[2] * c1f + c2[2] * c2f,
-                      c1[3] * c1f + c2[3] * c2f);
-            glColor4d(1, 1, 1, 1);
-
-            glEnable(GL_TEXTURE_2D);
-            glDisable(GL_DEPTH_TEST);
-
-            glBindTexture(GL_TEXTURE_2D, ammoFlash1);
-
-            glTranslated(mPosition.x, -mPosition.y, mPosition.z);
-            glRotated(DEG(-rotation), 0, 0, 1);
-            glPushMatrix();
-            glTranslated(0, -24, 0);
-            glScaled(10, 10, 0);
-            drawQuad(1.3, 5 * esz);
-            glPopMatrix();
-            glColor4d(1, 1, 1, .5);
-            glTranslated(0, -15, 0);
-            glRotatef(rand(), 0, 0, 1);
-            glScaled(50, 50, 0);
-            drawQuad(.85 * esz, .6 * esz);
-
-            glDisable(GL_TEXTURE_2D);
-            glEnable(GL_DEPTH_TEST);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glPopMatrix();
-        }
-        if (shield.getStrength() > 0) {
-            draw::setColor(.4, .3, .2);
-        } else {
-            draw::setColor(.4, .3, .2, .5);
+            double esz = .65,
+                   a = -rotation,
+                   x = mPosition.x,
+                   y = -mPosition.y;
+
+            // flame behind the ship, then a randomly turning flare over it
+            snap.sprites.add(ammoFlash1, x + 24 * sin(a), y - 24 * cos(a), mPosition.z,
+                             13, 50 * esz, a, 1, 1, 1, 1);
+            snap.sprites.add(ammoFlash1, x + 15 * sin(a), y - 15 * cos(a), mPosition.z,
+                             42.5 * esz, 30 * esz, a + RAD(rand() % 360), 1, 1, 1, .5);
         }
 
-        glPushMatrix();
-        glTranslated(mPosition.x, -mPosition.y, mPosition.z);
-        glRotated(DEG(-rotation) + 90, 0, 0, 1);
-        glCallList(SPHERE);
-        glPopMatrix();
-
-    } else if (getState() == DYING) {
-        explosion.draw();
+        Snapshot::Item& item = snap.addItem(render);
+        item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
+        item.rotation = rotation;
+        item.a = shield.getStrength() > 0 ? 1 : .5;
     }
 }
 
@@ -253,12 +218,12 @@ inline void launch(Ship& ship,
                    double dist,
                    double ang)
 {
-    (void)new Missile(ScreenObject::PLAYER_TYPE,
-                      ship.rotation + dir,
-                      ship.mPosition.x + (dist * sin(ship.rotation + ang)),
-                      ship.mPosition.y - (dist * cos(ship.rotation + ang)),
-                      ship.mPosition.z,
-                      ship.mVelocity.x, ship.mVelocity.y, ship.mVelocity.z);
+    Missiles::getInstance().fire(ScreenObject::PLAYER_TYPE,
+                                 ship.rotation + dir,
+                                 ship.mPosition.x + (dist * sin(ship.rotation + ang)),
+                                 ship.mPosition.y - (dist * cos(ship.rotation + ang)),
+                                 ship.mPosition.z,
+                                 ship.mVelocity.x, ship.mVelocity.y, ship.mVelocity.z);
 }
 
 void Ship::fire()
@@ -287,29 +252,10 @@ void Ship::fire()
     }
 }
 
-extern bool mDrawP;
-
 void Ship::accelerate(double amt)
 {
-    if (mDrawP) {
-        for (int i = 0; i < (rand() % 30); i++) {
-            float p = RAD((rand() % 61) - 30);
-            double r, g, b;
-            r = 1;
-            g = (double)(rand() % 80) / 100;
-            b = (double)(rand() % 30) / 100;
-            double t = (double)((rand() % 120)) / 5.0;
-
-            addParticle(mPosition.x - radius * sin(rotation) + ((rand() % 7) - 3),
-                        mPosition.y + radius * cos(rotation) + ((rand() % 7) - 3),
-                        mPosition.z + (rand() % 7) - 3,
-                        -sin(rotation + p) * mMaxSpeed * .5,
-                        cos(rotation + p) * mMaxSpeed * .5,
-                        sin(p) * mMaxSpeed * .5,
-                        r, g, b, t);
-        }
-    }
-
+    ParticleSystem& particles = ParticleSystem::getInstance();
+    particles.emit(particles.thruster(), *this, mMaxSpeed, mMaxSpeed);
     ScreenObject::accelerate(amt);
 }
 
@@ -327,14 +273,11 @@ void Ship::damage(double amt)
         return;
     }
 
-    static float pos[3] = { 0.0, 0.0, 0.0 };
     if (shield.getStrength() == 0) {
         if (amt > mLife) {
             if (isAlive()) {
                 setState(DYING);
-                Global::audio->playSound(Audio::EXPLOSION, pos);
-                explosion.age = 0;
-                explosion.finished = false;
+                Global::audio->playSound(Audio::EXPLOSION, 0);
                 explosion.init(*this);
             }
             mLife = 0;
@@ -342,7 +285,7 @@ void Ship::damage(double amt)
             mLife -= amt;
         }
     } else {
-        Global::audio->playSound(Audio::LIFE_LOSE, pos);
+        Global::audio->playSound(Audio::LIFE_LOSE, 0);
         shield.damage(amt);
     }
 }
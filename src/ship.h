@@ -79,13 +79,15 @@ public:
     Ship(double x, double y);
     ~Ship();
 
-    void draw();
+    void record(Snapshot& snap);
     void fire();
     void move(double dt);
     void accelerate(double amt);
     void init();
 
     bool collision(ScreenObject& obj);
+    void collided(ScreenObject& obj, const CollisionEvent& e);
+    bool shot(ObjectType owner);
 
     void rotate(double amt);
     void damage(double amt);
@@ -12,6 +12,8 @@
 #include "draw.h"
 #include "global.h"
 #include "model.h"
+#include "particle.h"
+#include "quality.h"
 
 NeuralNetwork<4, 6, 2> Smarty::brain;
 
@@ -29,27 +31,10 @@ inline double fixR(double r)
 inline double FUZZ(double r) { return fixR(r) / D_PI; }
 inline double DFUZ(double n) { return n * D_PI; }
 
-extern bool mDrawP;
-
 void Smarty::accelerate(double amt)
 {
-    if (mDrawP) {
-        for (int i = 0; i < (rand() % 30); i++) {
-            float p = RAD((rand() % 61) - 30);
-            double r, g, b;
-            r = 1;
-            g = (double)(rand() % 80) / 100;
-            b = (double)(rand() % 30) / 100;
-            double t = (double)((rand() % 120)) / 5.0;
-            addParticle(mPosition.x - radius * sin(rotation) + ((rand() % 7) - 3),
-                        mPosition.y + radius * cos(rotation) + ((rand() % 7) - 3),
-                        mPosition.z + (rand() % 7) - 3,
-                        -sin(rotation + p) * speed * .5,
-                        cos(rotation + p) * speed * .5,
-                        sin(p) * 15 * .5,
-                        r, g, b, t);
-        }
-    }
+    ParticleSystem& particles = ParticleSystem::getInstance();
+    particles.emit(particles.thruster(), *this, speed, 15);
     ScreenObject::accelerate(amt);
 }
 
@@ -61,6 +46,8 @@ Smarty::Smarty()
                    (double)(rand() % Screen::maxY()),
                    0,
                    0, 0, 0)
+    , mSkipped(0)
+    , mThrust(0)
 {
     mLastPosition.set(mPosition);
     mLastForce.set(mVelocity);
@@ -68,14 +55,6 @@ Smarty::Smarty()
 
     r = .2, g = .3, b = .4;
     setState(ALIVE);
-    if (SMARTY == -1) {
-        SMARTY = glGenLists(1);
-        glNewList(SMARTY, GL_COMPILE);
-        GLUquadricObj* m = gluNewQuadric();
-        gluSphere(m, radius, radius + 3, 10);
-        gluDeleteQuadric(m);
-        glEndList();
-    }
 }
 
 Smarty::~Smarty()
@@ -112,35 +91,42 @@ void Smarty::move(double dt)
 {
     static Coord3<double> mDiff, ppp;
     if (isAlive()) {
-        mDiff = Global::ship->mPosition - mPosition;
-        // train based on last position
-        ppp = mDiff - mLastPosition;
-        double d = ppp.length();
-        if (d >= 1) {
-            d = 1 / (d * d * d);
-        } else {
-            d = 0;
+        // Training is the costly part. Off screen it is done only every
+        // Quality::aiInterval() ticks, coasting on the last answer between.
+        if (onScreen() || ++mSkipped >= Quality::getInstance().aiInterval()) {
+            mSkipped = 0;
+
+            mDiff = Global::ship->mPosition - mPosition;
+            // train based on last position
+            ppp = mDiff - mLastPosition;
+            double d = ppp.length();
+            if (d >= 1) {
+                d = 1 / (d * d * d);
+            } else {
+                d = 0;
+            }
+            d = 1 - d;
+            double data1[4] = { fzAngle(mDiff), fzAngle(mVelocity), fzMag(mMaxSpeed, mVelocity), dt };
+            double result1[2] = { fzAngle(mDiff), d };
+            brain.train(data1, result1, .000001, 0.003, 100);
+
+            // get the ship differential vector
+            mLastPosition.set(mDiff);
+            mLastForce.set(mVelocity);
+            mLastShipPos.set(Global::ship->mPosition);
+
+            // build input and output vectors
+            double data2[4] = { fzAngle(mDiff), fzAngle(mVelocity), fzMag(mMaxSpeed, mVelocity), dt };
+            double result2[2] = { 0, 0 };
+
+            brain.run(data2, result2);
+
+            // behave based upon output
+
+            rotation = DFUZ(result2[0]);
+            mThrust = result2[1];
         }
-        d = 1 - d;
-        double data1[4] = { fzAngle(mDiff), fzAngle(mVelocity), fzMag(mMaxSpeed, mVelocity), dt };
-        double result1[2] = { fzAngle(mDiff), d };
-        brain.train(data1, result1, .000001, 0.003, 100);
-
-        // get the ship differential vector
-        mLastPosition.set(mDiff);
-        mLastForce.set(mVelocity);
-        mLastShipPos.set(Global::ship->mPosition);
-
-        // build input and output vectors
-        double data2[4] = { fzAngle(mDiff), fzAngle(mVelocity), fzMag(mMaxSpeed, mVelocity), dt };
-        double result2[2] = { 0, 0 };
-
-        brain.run(data2, result2);
-
-        // behave based upon output
-
-        rotation = DFUZ(result2[0]);
-        accelerate(result2[1] * dt * .5);
+        accelerate(mThrust * dt * .5);
     } else if (isDying()) {
         if (mExplosion.finished) {
             setState(DEAD);
@@ -154,11 +140,10 @@ bool Smarty::collision(ScreenObject& obj)
 {
     return true;
 #if 0
-    static float pos[3] = { 0.0, 0.0, 0.0 };
-
     if (isAlive()) {
         if ((obj.type() == MISSILE_TYPE) && (obj.ownerType() == PLAYER_TYPE)) {
             setState(DYING);
+            float pos[3] = { (float)mPosition.x, (float)mPosition.y, 0 };
             Global::audio->playSound(Audio::EXPLO_POP, pos);
             mExplosion.init(*this);
         }
@@ -168,15 +153,29 @@ bool Smarty::collision(ScreenObject& obj)
 #endif
 }
 
-void Smarty::draw()
+static void render(const Snapshot::Item& item)
+{
+    if (SMARTY == -1) {
+        SMARTY = glGenLists(1);
+        glNewList(SMARTY, GL_COMPILE);
+        GLUquadricObj* m = gluNewQuadric();
+        gluSphere(m, SMARTY_RADIUS, SMARTY_RADIUS + 3, 10);
+        gluDeleteQuadric(m);
+        glEndList();
+    }
+
+    glPushMatrix();
+    glTranslated(item.x, -item.y, item.z);
+    draw::setColor(item.r, item.g, item.b);
+    glCallList(SMARTY);
+    glPopMatrix();
+}
+
+void Smarty::record(Snapshot& snap)
 {
     if (isAlive()) {
-        glPushMatrix();
-        glTranslated(mPosition.x, -mPosition.y, mPosition.z);
-        draw::setColor(r, g, b);
-        glCallList(SMARTY);
-        glPopMatrix();
-    } else if (isDying()) {
-        mExplosion.draw();
+        Snapshot::Item& item = snap.addItem(render);
+        item.x = mPosition.x, item.y = mPosition.y, item.z = mPosition.z;
+        item.r = r, item.g = g, item.b = b;
     }
 }
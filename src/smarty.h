@@ -24,12 +24,14 @@ private:
     Explosion<10> mExplosion;
     static NeuralNetwork<4, 6, 2> brain; // shared brain! how cool is that?
     Coord3<double> mLastPosition, mLastForce, mLastShipPos;
+    unsigned int mSkipped; // ticks since the brain was last run
+    double mThrust;
 
 public:
     Smarty();
     ~Smarty();
 
-    void draw();
+    void record(Snapshot& snap);
 
     void rotate(double amt);
     void move(double dt);
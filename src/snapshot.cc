@@ -0,0 +1,222 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "snapshot.h"
+#include "draw.h"
+#include "geom.h"
+#include "quality.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// meshes whose last snapshot has gone, waiting for the render thread
+static std::mutex releasedLock;
+static std::vector<IndexedMesh*> released;
+
+Snapshot::Snapshot()
+    : tick(0)
+    , dt(0)
+    , quality(Quality::MAX_LEVEL)
+    , idle(false)
+    , scene(true)
+    , idleSpell(0)
+{
+    menu.shown = false;
+    menu.selected = menu.count = 0;
+}
+
+void Snapshot::clear()
+{
+    // clear() keeps the capacity, so after the first few ticks recording
+    // a snapshot does not allocate
+    items.clear();
+    debris.clear();
+    particles.clear();
+    blips.clear();
+    sprites.clear();
+    menu.shown = false;
+}
+
+Snapshot::Item& Snapshot::addItem(Renderer render)
+{
+    items.push_back(Item());
+    Item& item = items.back();
+    item.render = render;
+    item.a = 1;
+    return item;
+}
+
+void Snapshot::sphere(const Item& item)
+{
+    Coord3<double> pos(item.x, item.y, item.z);
+    draw::setColor(item.r, item.g, item.b, item.a);
+    draw::sphere(pos, item.radius, 3, 10, Quality::getInstance().sphereDetail());
+}
+
+// Every piece of debris is the same triangle, turned and placed. There is
+// no instancing in the GL we target, so the three corners of each are
+// worked out here into one array, drawn with a single glDrawArrays.
+
+void Snapshot::drawDebris() const
+{
+    if (debris.empty()) {
+        return;
+    }
+
+    // matches the GL_C4UB_V3F interleaved layout
+    struct DebrisVertex {
+        unsigned char c[4];
+        float x, y, z;
+    };
+
+    static std::vector<DebrisVertex> vertices;
+    vertices.resize(debris.size() * 3);
+
+    const float DEG_TO_RAD = (float)(M_PI / 180);
+
+    for (std::size_t n = 0; n < debris.size(); n++) {
+        const Debris& d = debris[n];
+
+        // the first two columns of Rx(rx) Ry(ry) Rz(rz), which is all the
+        // flat triangle needs
+        float ca = cosf(d.rx * DEG_TO_RAD), sa = sinf(d.rx * DEG_TO_RAD),
+              cb = cosf(d.ry * DEG_TO_RAD), sb = sinf(d.ry * DEG_TO_RAD),
+              cc = cosf(d.rz * DEG_TO_RAD), sc = sinf(d.rz * DEG_TO_RAD);
+
+        float ux = cb * cc, uy = ca * sc + sa * sb * cc, uz = sa * sc - ca * sb * cc;
+        float vx = -cb * sc, vy = ca * cc - sa * sb * sc, vz = sa * cc + ca * sb * sc;
+
+        // corners at (radius, 0), (0, radius / 2) and (0, -radius / 2)
+        float h = d.radius / 2;
+        const float cx[3] = { d.radius, 0, 0 },
+                    cy[3] = { 0, h, -h };
+
+        DebrisVertex v;
+        v.c[0] = (unsigned char)(d.r * 255);
+        v.c[1] = (unsigned char)(d.g * 255);
+        v.c[2] = (unsigned char)(d.b * 255);
+        v.c[3] = (unsigned char)(std::max(0.0f, std::min(1.0f, d.a)) * 255);
+
+        for (int i = 0; i < 3; i++) {
+            v.x = d.x + cx[i] * ux + cy[i] * vx;
+            v.y = -d.y + cx[i] * uy + cy[i] * vy;
+            v.z = d.z + cx[i] * uz + cy[i] * vz;
+            vertices[n * 3 + i] = v;
+        }
+    }
+
+    glDisable(GL_LIGHTING);
+    glDisable(GL_LIGHT0);
+    glDisable(GL_LIGHT1);
+
+    glInterleavedArrays(GL_C4UB_V3F, sizeof(DebrisVertex), &vertices[0]);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_LIGHT1);
+}
+
+void Snapshot::drawParticles() const
+{
+    if (particles.empty()) {
+        return;
+    }
+
+    draw::startPoints();
+    for (std::size_t n = 0; n < particles.size(); n++) {
+        const Point& p = particles[n];
+        draw::setColor(p.r, p.g, p.b);
+        draw::point((int)p.x, (int)p.y, (int)p.z);
+    }
+    draw::endPoints();
+}
+
+static void releaseMesh(IndexedMesh* mesh)
+{
+    std::lock_guard<std::mutex> lock(releasedLock);
+    released.push_back(mesh);
+}
+
+std::shared_ptr<IndexedMesh> Snapshot::shareMesh(IndexedMesh* mesh)
+{
+    return std::shared_ptr<IndexedMesh>(mesh, releaseMesh);
+}
+
+void Snapshot::collectMeshes()
+{
+    std::vector<IndexedMesh*> meshes;
+    {
+        std::lock_guard<std::mutex> lock(releasedLock);
+        meshes.swap(released);
+    }
+    for (std::size_t i = 0; i < meshes.size(); i++) {
+        delete meshes[i];
+    }
+}
+
+// --------------------------------------------------------------------------
+
+SnapshotBuffer::SnapshotBuffer()
+    : mBack(0)
+    , mFront(1)
+    , mReady(2)
+    , mSkipped(0)
+{
+}
+
+void SnapshotBuffer::publish()
+{
+    int old;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // the reader will never see the snapshot this one replaces, so
+        // this one carries its game time as well
+        int ready = mReady.load(std::memory_order_relaxed);
+        if (ready & FRESH) {
+            mSlots[mBack].dt += mSlots[ready & ~FRESH].dt;
+        }
+        old = mReady.exchange(mBack | FRESH, std::memory_order_acq_rel);
+    }
+    mPublished.notify_one();
+
+    // the reader never saw the one this replaces
+    if (old & FRESH) {
+        mSkipped++;
+    }
+    mBack = old & ~FRESH;
+}
+
+// Takes the lock publish() holds while it adds up the time of snapshots
+// the reader missed, so none is counted twice or lost
+
+bool SnapshotBuffer::acquire()
+{
+    if (!(mReady.load(std::memory_order_acquire) & FRESH)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    int old = mReady.exchange(mFront, std::memory_order_acq_rel);
+    mFront = old & ~FRESH;
+    return true;
+}
+
+bool SnapshotBuffer::wait(unsigned int ms)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mPublished.wait_for(lock, std::chrono::milliseconds(ms), [this] {
+        return (mReady.load(std::memory_order_acquire) & FRESH) != 0;
+    });
+}
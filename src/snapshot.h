@@ -0,0 +1,174 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_SNAPSHOT_H
+#define SSC_SNAPSHOT_H
+
+#include "sprite.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class IndexedMesh;
+
+// --------------------------------------------------------------------------
+//
+// CLASS: Snapshot
+//
+// Everything needed to draw one tick of the game, copied out of the model
+// by the simulation so that drawing never reads a live object. Each
+// ScreenObject records itself as an Item carrying the function that draws
+// it; explosion debris, particles, sprites, the radar, the HUD and the
+// menu have their own plain arrays.
+//
+// Only GL resources the renderer creates itself are referred to, with
+// the one exception of asteroid meshes: those are shared, and are freed
+// on the render thread once the last snapshot holding one is gone (see
+// shareMesh()).
+//
+// --------------------------------------------------------------------------
+
+struct Snapshot {
+    struct Item;
+    typedef void (*Renderer)(const Item&);
+
+    struct Item {
+        Renderer render;
+        float x, y, z;
+        float rotation;
+        float r, g, b, a;
+        float radius;
+        float param[3]; // whatever else the renderer needs
+        std::shared_ptr<IndexedMesh> mesh;
+    };
+
+    struct Debris {
+        float x, y, z;
+        float rx, ry, rz; // rotation in degrees about each axis
+        float radius;
+        float r, g, b, a;
+    };
+
+    struct Point {
+        float x, y, z;
+        float r, g, b;
+    };
+
+    // a live object on the radar
+    struct Blip {
+        float x, y;
+        float r, g, b;
+    };
+
+    struct Player {
+        float x, y;
+        float rotation, speed;
+        float shield, life;
+    };
+
+    struct Menu {
+        bool shown;
+        unsigned int selected, count;
+        const char* items[10];
+    };
+
+    Snapshot();
+
+    void clear();
+
+    Item& addItem(Renderer render);
+
+    std::vector<Item> items;
+    std::vector<Debris> debris;
+    std::vector<Point> particles;
+    std::vector<Blip> blips;
+    SpriteBatch sprites;
+
+    Player ship;
+    Menu menu;
+    unsigned long tick;
+    float dt; // game time since the previous snapshot the reader took
+    int quality; // see Quality::level()
+
+    // Paused or in the menu. The first snapshots of an idle spell carry
+    // the scene, for the renderer to keep as a backdrop; once it has,
+    // they only carry the menu (see Model::record()).
+    bool idle;
+    bool scene;
+    unsigned int idleSpell;
+
+    // a renderer for items that are plain spheres of the item's colour
+    static void sphere(const Item& item);
+
+    // render thread only
+    void drawDebris() const;
+    void drawParticles() const;
+
+    // A shared_ptr to mesh whose deleter hands the mesh to the render
+    // thread, so its display list is deleted in the right context.
+    static std::shared_ptr<IndexedMesh> shareMesh(IndexedMesh* mesh);
+
+    // deletes the meshes released since the last call; render thread only
+    static void collectMeshes();
+};
+
+// --------------------------------------------------------------------------
+//
+// CLASS: SnapshotBuffer
+//
+// A triple buffer of snapshots between one writer (the simulation) and
+// one reader (the renderer). The writer fills back() and publishes it;
+// the reader takes the newest published snapshot with acquire() and keeps
+// drawing it until a newer one arrives. Neither side waits on the other
+// for longer than a swap of indices, and the writer may publish any
+// number of ticks between two reads; only the latest is drawn, with the
+// dt of those it replaced added to its own.
+//
+// --------------------------------------------------------------------------
+
+class SnapshotBuffer {
+public:
+    SnapshotBuffer();
+
+    // writer
+    Snapshot& back() { return mSlots[mBack]; }
+    void publish();
+
+    // reader
+    const Snapshot& front() { return mSlots[mFront]; }
+    bool acquire();
+
+    // reader: blocks for up to ms milliseconds until something has been
+    // published that acquire() has not taken yet
+    bool wait(unsigned int ms);
+
+    // snapshots published and replaced before the reader took them
+    unsigned long skipped() { return mSkipped; }
+
+private:
+    static const int FRESH = 4;
+
+    Snapshot mSlots[3];
+    int mBack, mFront;
+
+    // the slot between the two sides, with FRESH set if it is newer than
+    // the reader's
+    std::atomic<int> mReady;
+
+    std::mutex mMutex;
+    std::condition_variable mPublished;
+
+    std::atomic<unsigned long> mSkipped;
+};
+
+#endif // SSC_SNAPSHOT_H
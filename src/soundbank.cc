@@ -0,0 +1,304 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "soundbank.h"
+#include "asset.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+// --------------------------------------------------------------------------
+//
+// File format
+//
+// A header, one entry per sound, then the sample data. Each sound starts
+// on a 16 byte boundary. All fields are in host byte order; a bank is
+// never moved between machines.
+//
+// --------------------------------------------------------------------------
+
+static const char BANK_MAGIC[4] = { 'S', 'S', 'C', 'B' };
+static const uint32_t BANK_VERSION = 1;
+static const char* BANK_NAME = "sounds.bank";
+
+struct BankHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t frequency;
+    uint32_t format;
+    int32_t channels;
+    uint32_t count;
+};
+
+struct BankEntry {
+    char name[32];
+    int64_t sourceSize;
+    int64_t sourceTime;
+    uint32_t offset;
+    uint32_t length;
+};
+
+static uint32_t align16(uint32_t n)
+{
+    return (n + 15) & ~15u;
+}
+
+// The source file's size and modification time, both zero if it is missing
+static void sourceStamp(const std::string& path, int64_t* size, int64_t* time)
+{
+    struct stat st;
+    if (path.empty() || stat(path.c_str(), &st) != 0) {
+        *size = *time = 0;
+        return;
+    }
+    *size = st.st_size;
+    *time = st.st_mtime;
+}
+
+static BankHeader deviceHeader(uint32_t count)
+{
+    BankHeader h;
+    int frequency = 0, channels = 0;
+    Uint16 format = 0;
+
+    Mix_QuerySpec(&frequency, &format, &channels);
+
+    memcpy(h.magic, BANK_MAGIC, sizeof(h.magic));
+    h.version = BANK_VERSION;
+    h.frequency = frequency;
+    h.format = format;
+    h.channels = channels;
+    h.count = count;
+    return h;
+}
+
+// The bank goes in ~/.ssc, which is created if need be, or else next to
+// the data.
+
+static std::string bankPath()
+{
+    const char* home = getenv("HOME");
+    if (home) {
+        std::string dir = std::string(home) + "/.ssc";
+        if (mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST) {
+            return dir + "/" + BANK_NAME;
+        }
+    }
+    return std::string(AssetManager::getInstance().dataDir()) + "/" + BANK_NAME;
+}
+
+// --------------------------------------------------------------------------
+
+SoundBank::SoundBank()
+    : mMap(0)
+    , mMapSize(0)
+    , mSize(0)
+{
+}
+
+SoundBank::~SoundBank()
+{
+    close();
+}
+
+void SoundBank::open(const char* const* names, int count)
+{
+    close();
+
+    AssetManager& assets = AssetManager::getInstance();
+    std::vector<Source> sources(count);
+
+    for (int i = 0; i < count; i++) {
+        if (!names[i]) {
+            continue;
+        }
+        AssetManager::Handle h = assets.find(names[i]);
+        if (h == AssetManager::INVALID) {
+            continue;
+        }
+        sources[i].name = names[i];
+        sources[i].path = assets.path(h);
+    }
+
+    mChunks.assign(count, 0);
+
+    std::string bank = bankPath();
+    if (map(bank, sources)) {
+        return;
+    }
+    if (write(bank, sources) && map(bank, sources)) {
+        return;
+    }
+
+    fprintf(stderr, "Could not use sound bank %s, decoding sounds in memory\n",
+            bank.c_str());
+    decode(sources);
+}
+
+bool SoundBank::map(const std::string& bank, const std::vector<Source>& sources)
+{
+    int fd = ::open(bank.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (std::size_t)st.st_size >= sizeof(BankHeader)) {
+        map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    std::size_t size = st.st_size;
+    const unsigned char* base = (const unsigned char*)map;
+    const BankHeader* header = (const BankHeader*)base;
+    const BankEntry* entries = (const BankEntry*)(header + 1);
+    BankHeader device = deviceHeader(sources.size());
+
+    bool valid = !memcmp(header, &device, sizeof(BankHeader))
+        && sizeof(BankHeader) + sources.size() * sizeof(BankEntry) <= size;
+
+    for (std::size_t i = 0; valid && i < sources.size(); i++) {
+        const BankEntry& e = entries[i];
+        int64_t sourceSize, sourceTime;
+        sourceStamp(sources[i].path, &sourceSize, &sourceTime);
+
+        valid = !strncmp(e.name, sources[i].name.c_str(), sizeof(e.name))
+            && e.sourceSize == sourceSize && e.sourceTime == sourceTime
+            && (std::size_t)e.offset + e.length <= size;
+    }
+
+    if (!valid) {
+        munmap(map, size);
+        return false;
+    }
+
+    mMap = map;
+    mMapSize = size;
+    mSize = 0;
+
+    // SDL_mixer only reads a chunk's samples, so it can play them from a
+    // read-only mapping
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        if (entries[i].length > 0) {
+            mChunks[i] = Mix_QuickLoad_RAW((Uint8*)(base + entries[i].offset), entries[i].length);
+            mSize += entries[i].length;
+        }
+    }
+    return true;
+}
+
+// Decodes every source into the device format and writes the bank
+// beside its final name, then renames it into place so a reader never
+// sees half a bank.
+
+bool SoundBank::write(const std::string& bank, const std::vector<Source>& sources)
+{
+    std::vector<BankEntry> entries(sources.size());
+    std::vector<Mix_Chunk*> decoded(sources.size(), (Mix_Chunk*)0);
+
+    uint32_t offset = align16(sizeof(BankHeader) + sources.size() * sizeof(BankEntry));
+
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        BankEntry& e = entries[i];
+        memset(&e, 0, sizeof(e));
+        strncpy(e.name, sources[i].name.c_str(), sizeof(e.name) - 1);
+        sourceStamp(sources[i].path, &e.sourceSize, &e.sourceTime);
+
+        if (e.sourceSize > 0) {
+            decoded[i] = Mix_LoadWAV(sources[i].path.c_str());
+        }
+        if (decoded[i]) {
+            e.offset = offset;
+            e.length = decoded[i]->alen;
+            offset = align16(offset + e.length);
+        }
+    }
+
+    std::string temp = bank + ".tmp";
+    FILE* fp = fopen(temp.c_str(), "wb");
+    bool ok = fp != 0;
+
+    if (ok) {
+        BankHeader header = deviceHeader(sources.size());
+        static const unsigned char zero[16] = { 0 };
+
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+        if (ok && !entries.empty()) {
+            ok = fwrite(&entries[0], sizeof(BankEntry), entries.size(), fp) == entries.size();
+        }
+        for (std::size_t i = 0; ok && i < sources.size(); i++) {
+            if (!decoded[i]) {
+                continue;
+            }
+            long pad = entries[i].offset - ftell(fp);
+            ok = fwrite(zero, 1, pad, fp) == (std::size_t)pad
+                && fwrite(decoded[i]->abuf, 1, decoded[i]->alen, fp) == decoded[i]->alen;
+        }
+        ok = (fclose(fp) == 0) && ok;
+        ok = ok && rename(temp.c_str(), bank.c_str()) == 0;
+        if (!ok) {
+            unlink(temp.c_str());
+        }
+    }
+
+    for (std::size_t i = 0; i < decoded.size(); i++) {
+        if (decoded[i]) {
+            Mix_FreeChunk(decoded[i]);
+        }
+    }
+    return ok;
+}
+
+void SoundBank::decode(const std::vector<Source>& sources)
+{
+    mSize = 0;
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        if (!sources[i].path.empty()) {
+            mChunks[i] = Mix_LoadWAV(sources[i].path.c_str());
+        }
+        if (mChunks[i]) {
+            mSize += mChunks[i]->alen;
+        }
+    }
+}
+
+void SoundBank::close()
+{
+    // chunks made by Mix_QuickLoad_RAW do not own their samples, so this
+    // only frees the decoded ones' buffers
+    for (std::size_t i = 0; i < mChunks.size(); i++) {
+        if (mChunks[i]) {
+            Mix_FreeChunk(mChunks[i]);
+        }
+    }
+    mChunks.clear();
+
+    if (mMap) {
+        munmap(mMap, mMapSize);
+        mMap = 0;
+        mMapSize = 0;
+    }
+    mSize = 0;
+}
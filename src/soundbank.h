@@ -0,0 +1,71 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_SOUNDBANK_H
+#define SSC_SOUNDBANK_H
+
+#include <SDL/SDL_mixer.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: SoundBank
+//
+// The sound effects, already converted to the open device's sample rate,
+// format and channel count, in a single file that is memory mapped and
+// played straight out of the mapping. The bank is written the first time
+// the game runs with a given device format, and again whenever one of the
+// source files changes size or modification time; after that, starting
+// up costs one mmap() instead of decoding and resampling every file.
+//
+// If the bank cannot be written the effects are decoded into memory as
+// before.
+//
+// --------------------------------------------------------------------------
+
+class SoundBank {
+public:
+    SoundBank();
+    ~SoundBank();
+
+    // Loads the named files from the data directory; a null name is left
+    // empty. Must be called after Mix_OpenAudio().
+    void open(const char* const* names, int count);
+
+    // Frees the chunks and unmaps the bank. Must be called before
+    // Mix_CloseAudio().
+    void close();
+
+    // NULL if the sound is missing or could not be decoded
+    Mix_Chunk* chunk(int n) { return n < (int)mChunks.size() ? mChunks[n] : 0; }
+
+    // bytes of sample data mapped or decoded
+    std::size_t size() { return mSize; }
+    bool mapped() { return mMap != 0; }
+
+private:
+    struct Source {
+        std::string name, path;
+    };
+
+    bool map(const std::string& bank, const std::vector<Source>& sources);
+    bool write(const std::string& bank, const std::vector<Source>& sources);
+    void decode(const std::vector<Source>& sources);
+
+    void* mMap;
+    std::size_t mMapSize;
+    std::size_t mSize;
+    std::vector<Mix_Chunk*> mChunks;
+};
+
+#endif // SSC_SOUNDBANK_H
@@ -0,0 +1,74 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "spatial.h"
+#include "screen.h"
+
+#include <algorithm>
+
+// Large enough that most objects sit in one to four cells
+const double SPATIAL_CELL_SIZE = 128;
+
+SpatialIndex::SpatialIndex()
+    : mCellSize(SPATIAL_CELL_SIZE)
+    , mColumns(1)
+    , mRows(1)
+    , mQuery(0)
+{
+}
+
+void SpatialIndex::build(ScreenObject* head)
+{
+    mColumns = std::max(1, (int)(Screen::maxX() / mCellSize) + 1);
+    mRows = std::max(1, (int)(Screen::maxY() / mCellSize) + 1);
+
+    mObjects.clear();
+    for (ScreenObject* i = head; i; i = i->next) {
+        if (i->isAlive()) {
+            i->sync();
+            mObjects.push_back(i);
+        }
+    }
+
+    // Two passes: count the entries per cell, then place them
+
+    mCellStart.assign(mColumns * mRows + 1, 0);
+
+    for (std::size_t n = 0; n < mObjects.size(); n++) {
+        const ScreenObject& obj = *mObjects[n];
+        int c0 = column(obj.mPosition.x - obj.radius), c1 = column(obj.mPosition.x + obj.radius),
+            r0 = row(obj.mPosition.y - obj.radius), r1 = row(obj.mPosition.y + obj.radius);
+
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++)
+                mCellStart[r * mColumns + c + 1]++;
+        }
+    }
+
+    for (std::size_t c = 1; c < mCellStart.size(); c++)
+        mCellStart[c] += mCellStart[c - 1];
+
+    mEntries.resize(mCellStart.back());
+    std::vector<unsigned int> fill(mCellStart.begin(), mCellStart.end() - 1);
+
+    for (std::size_t n = 0; n < mObjects.size(); n++) {
+        const ScreenObject& obj = *mObjects[n];
+        int c0 = column(obj.mPosition.x - obj.radius), c1 = column(obj.mPosition.x + obj.radius),
+            r0 = row(obj.mPosition.y - obj.radius), r1 = row(obj.mPosition.y + obj.radius);
+
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++)
+                mEntries[fill[r * mColumns + c]++] = n;
+        }
+    }
+
+    mStamp.assign(mObjects.size(), 0);
+    mQuery = 0;
+}
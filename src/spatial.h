@@ -0,0 +1,109 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_SPATIAL_H
+#define SSC_SPATIAL_H
+
+#include "object.h"
+
+#include <algorithm>
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: SpatialIndex
+//
+// A uniform grid over the gameplay area holding every live ScreenObject.
+// It is rebuilt after the world step for the missiles, and again after
+// the objects have moved for view culling (see Model::cull). Each object
+// is entered in every cell its bounding square touches, so a query only
+// has to look at the cells overlapping the query rectangle. Objects
+// outside the area are clamped into the border cells.
+//
+// The cells are stored flat: mCellStart[c] .. mCellStart[c + 1] index the
+// entries of cell c in mEntries.
+//
+// --------------------------------------------------------------------------
+
+class SpatialIndex {
+public:
+    static SpatialIndex& getInstance()
+    {
+        static SpatialIndex instance;
+        return instance;
+    }
+
+    // syncs each live object's position out of ODE and files it
+    void build(ScreenObject* head);
+
+    // Calls f(ScreenObject&) once for each object whose bounding square
+    // overlaps the rectangle [x0, x1] x [y0, y1].
+    template <class F>
+    void query(double x0, double y0, double x1, double y1, F f)
+    {
+        if (mObjects.empty())
+            return;
+
+        int c0 = column(x0), c1 = column(x1),
+            r0 = row(y0), r1 = row(y1);
+
+        if (++mQuery == 0) {
+            std::fill(mStamp.begin(), mStamp.end(), 0);
+            mQuery = 1;
+        }
+
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                int cell = r * mColumns + c;
+                for (unsigned int e = mCellStart[cell]; e < mCellStart[cell + 1]; e++) {
+                    unsigned int n = mEntries[e];
+                    if (mStamp[n] == mQuery)
+                        continue;
+                    mStamp[n] = mQuery;
+
+                    ScreenObject& obj = *mObjects[n];
+                    double rad = obj.radius;
+                    if (obj.mPosition.x + rad < x0 || obj.mPosition.x - rad > x1
+                        || obj.mPosition.y + rad < y0 || obj.mPosition.y - rad > y1)
+                        continue;
+                    f(obj);
+                }
+            }
+        }
+    }
+
+    std::size_t size() { return mObjects.size(); }
+    std::size_t entries() { return mEntries.size(); }
+
+private:
+    SpatialIndex();
+
+    inline int column(double x)
+    {
+        int c = (int)(x / mCellSize);
+        return c < 0 ? 0 : (c >= mColumns ? mColumns - 1 : c);
+    }
+    inline int row(double y)
+    {
+        int r = (int)(y / mCellSize);
+        return r < 0 ? 0 : (r >= mRows ? mRows - 1 : r);
+    }
+
+    double mCellSize;
+    int mColumns, mRows;
+
+    std::vector<ScreenObject*> mObjects;
+    std::vector<unsigned int> mCellStart;
+    std::vector<unsigned int> mEntries;
+    std::vector<unsigned int> mStamp;
+    unsigned int mQuery;
+};
+
+#endif // SSC_SPATIAL_H
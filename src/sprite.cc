@@ -0,0 +1,71 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#include "sprite.h"
+#include "draw.h"
+
+inline unsigned char toByte(double c)
+{
+    return (unsigned char)(c <= 0 ? 0 : (c >= 1 ? 255 : c * 255 + .5));
+}
+
+void SpriteBatch::add(const SpriteCell& cell,
+                      double x, double y, double z,
+                      double hx, double hy, double angle,
+                      double r, double g, double b, double a)
+{
+    const double c = cos(angle), s = sin(angle);
+
+    // corners in the order (-hx, hy), (-hx, -hy), (hx, -hy), (hx, hy),
+    // counter-clockwise so they survive back-face culling
+    const double cx[4] = { -hx, -hx, hx, hx },
+                 cy[4] = { hy, -hy, -hy, hy };
+    const float cu[4] = { cell.u0, cell.u0, cell.u1, cell.u1 },
+                cv[4] = { cell.v0, cell.v1, cell.v1, cell.v0 };
+
+    SpriteVertex v;
+    v.c[0] = toByte(r);
+    v.c[1] = toByte(g);
+    v.c[2] = toByte(b);
+    v.c[3] = toByte(a);
+    v.z = (float)z;
+
+    for (int i = 0; i < 4; i++) {
+        v.u = cu[i];
+        v.v = cv[i];
+        v.x = (float)(x + cx[i] * c - cy[i] * s);
+        v.y = (float)(y + cx[i] * s + cy[i] * c);
+        mVertices.push_back(v);
+    }
+}
+
+void SpriteBatch::draw() const
+{
+    if (mVertices.empty()) {
+        return;
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glBindTexture(GL_TEXTURE_2D, AssetManager::getInstance().spriteAtlas());
+    glNormal3f(0, 0, 1);
+
+    glInterleavedArrays(GL_T2F_C4UB_V3F, sizeof(SpriteVertex), &mVertices[0]);
+    glDrawArrays(GL_QUADS, 0, (GLsizei)mVertices.size());
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,57 @@
+// --------------------------------------------------------------------------
+//
+// Copyright (c) 2003 Thomas D. Marsh. All rights reserved.
+//
+// "SSC" is free software; you can redistribute it
+// and/or use it and/or modify it under the terms of
+// the "GNU General Public License" (GPL).
+//
+// --------------------------------------------------------------------------
+
+#ifndef SSC_SPRITE_H
+#define SSC_SPRITE_H
+
+#include "asset.h"
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+//
+// CLASS: SpriteBatch
+//
+// Collects the additively blended sprites (missiles, engine flashes) of a
+// frame and renders them in a single pass: one bind of the sprite atlas,
+// one blend/depth state change and one glDrawArrays. Additive blending is
+// order independent, so sprites are drawn in the order they were queued.
+// Each Snapshot carries its own batch, filled by the simulation and drawn
+// by the renderer.
+//
+// Positions are in GL space (y already flipped), the angle is in radians
+// about the z axis, and (hx, hy) are the half extents of the quad.
+//
+// --------------------------------------------------------------------------
+
+class SpriteBatch {
+public:
+    void add(const SpriteCell& cell,
+             double x, double y, double z,
+             double hx, double hy, double angle,
+             double r, double g, double b, double a);
+
+    void draw() const;
+    void clear() { mVertices.clear(); }
+
+    std::size_t size() const { return mVertices.size() / 4; }
+
+private:
+    // matches the GL_T2F_C4UB_V3F interleaved layout
+    struct SpriteVertex {
+        float u, v;
+        unsigned char c[4];
+        float x, y, z;
+    };
+
+    std::vector<SpriteVertex> mVertices;
+};
+
+#endif // SSC_SPRITE_H